@@ -0,0 +1,122 @@
+#include "../Utils/Ftype.hpp"
+#include "../Utils/Batch.hpp"
+#include <chrono>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Elements per second of the batch kernels against the element-at-a-time loop
+template <class FP, class Scalar, class Batch>
+void bench(const char *name, const char *op, Scalar scalar, Batch batch, double low = -1000.0)
+{
+    const size_t n = 1 << 22;
+    const int reps = 5;
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> dist(low, 1000.0);
+    std::vector<FP> a(n), b(n), out_scalar(n), out_batch(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        a[i] = FP(dist(gen));
+        b[i] = FP(dist(gen));
+    }
+
+    auto time = [&](auto &&body)
+    {
+        double best = 1e30;
+        for (int r = 0; r < reps; ++r)
+        {
+            auto start = std::chrono::steady_clock::now();
+            body();
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return n / best;
+    };
+
+    double scalar_rate = time([&]
+                              {
+        for (size_t i = 0; i < n; ++i)
+            out_scalar[i] = scalar(a[i], b[i]); });
+    double batch_rate = time([&]
+                             { batch(std::span<const FP>(a), std::span<const FP>(b), std::span<FP>(out_batch)); });
+
+    bool identical = std::memcmp(out_scalar.data(), out_batch.data(), n * sizeof(FP)) == 0;
+    std::cout << std::left << std::setw(6) << name << std::setw(5) << op
+              << "scalar " << std::setw(12) << scalar_rate / 1e6 << "M elem/s  "
+              << "batch " << std::setw(12) << batch_rate / 1e6 << "M elem/s  "
+              << "x" << std::setw(8) << batch_rate / scalar_rate << " "
+              << (identical ? "bit-identical" : "MISMATCH") << "\n";
+}
+
+// Dot product through fma_accumulate() against a loop of fma()
+template <class FP>
+void bench_dot(const char *name)
+{
+    const size_t n = 1 << 22;
+    const int reps = 5;
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    std::vector<FP> a(n), b(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        a[i] = FP(dist(gen));
+        b[i] = FP(dist(gen));
+    }
+
+    FP acc_scalar, acc_batch;
+    double scalar_best = 1e30, batch_best = 1e30;
+    for (int r = 0; r < reps; ++r)
+    {
+        auto start = std::chrono::steady_clock::now();
+        acc_scalar = FP(0.0);
+        for (size_t i = 0; i < n; ++i)
+            acc_scalar = fma(a[i], b[i], acc_scalar);
+        auto middle = std::chrono::steady_clock::now();
+        acc_batch = FP(0.0);
+        fma_accumulate(std::span<const FP>(a), std::span<const FP>(b), acc_batch);
+        auto end = std::chrono::steady_clock::now();
+        scalar_best = std::min(scalar_best, std::chrono::duration<double>(middle - start).count());
+        batch_best = std::min(batch_best, std::chrono::duration<double>(end - middle).count());
+    }
+
+    bool identical = std::memcmp(&acc_scalar, &acc_batch, sizeof(FP)) == 0;
+    std::cout << std::left << std::setw(6) << name << std::setw(5) << "dot"
+              << "scalar " << std::setw(12) << n / scalar_best / 1e6 << "M elem/s  "
+              << "batch " << std::setw(12) << n / batch_best / 1e6 << "M elem/s  "
+              << "x" << std::setw(8) << scalar_best / batch_best << " "
+              << (identical ? "bit-identical" : "MISMATCH") << "\n";
+}
+
+template <class FP>
+void bench_format(const char *name)
+{
+    bench<FP>(name, "add", [](const FP &x, const FP &y)
+              { return x + y; },
+              [](auto a, auto b, auto out)
+              { add(a, b, out); });
+    bench<FP>(name, "mul", [](const FP &x, const FP &y)
+              { return x * y; },
+              [](auto a, auto b, auto out)
+              { mul(a, b, out); });
+    bench<FP>(name, "div", [](const FP &x, const FP &y)
+              { return x / y; },
+              [](auto a, auto b, auto out)
+              { div(a, b, out); });
+    bench<FP>(name, "sqrt", [](const FP &x, const FP &)
+              { return x.sqrt(); },
+              [](auto a, auto, auto out)
+              { sqrt(a, out); },
+              0.0);
+    bench_dot<FP>(name);
+}
+
+int main()
+{
+    bench_format<Half>("Half");
+    bench_format<Float>("Float");
+    bench_format<CA25>("CA25");
+
+    return 0;
+}
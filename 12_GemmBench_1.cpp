@@ -0,0 +1,40 @@
+#include "../Utils/Ftype.hpp"
+#include "../Utils/Gemm.hpp"
+#include <chrono>
+#include <random>
+#include <vector>
+
+// Multiply-accumulates per second of gemm() for a few input/accumulator/output mixes
+template <class InT, class AccT, class OutT>
+void bench(const char *name, size_t size)
+{
+    const size_t m = size, n = size, k = size;
+
+    std::mt19937_64 gen(42);
+    std::uniform_real_distribution<double> dist(-1.0, 1.0);
+    std::vector<InT> A(m * k), B(k * n);
+    std::vector<OutT> C(m * n);
+    for (InT &value : A)
+        value = InT(dist(gen));
+    for (InT &value : B)
+        value = InT(dist(gen));
+
+    auto start = std::chrono::steady_clock::now();
+    gemm<InT, AccT, OutT>(std::span<const InT>(A), std::span<const InT>(B), std::span<OutT>(C), m, n, k);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    double macs = static_cast<double>(m) * n * k;
+    std::cout << std::left << std::setw(18) << name << std::setw(6) << size
+              << std::setw(10) << elapsed.count() << "s  "
+              << std::setw(12) << macs / elapsed.count() / 1e6 << "M MAC/s  "
+              << "4096^3 in ~" << 4096.0 * 4096.0 * 4096.0 / (macs / elapsed.count()) << "s\n";
+}
+
+int main()
+{
+    bench<Half, Float, Half>("Half/Float/Half", 1024);
+    bench<Float, Double, Float>("Float/Double", 512);
+    bench<Half, CA25, Float>("Half/CA25/Float", 256);
+
+    return 0;
+}
@@ -0,0 +1,240 @@
+#include "../Utils/Ftype.hpp"
+#include "../Utils/Batch.hpp"
+#include "../Utils/Lut.hpp"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+// Cost per operation of the FloatingPoint operations on Half, Float, Double and CA25,
+// one element at a time and through the batch kernels, over buffers of 1 to 10^7
+// elements. Prints a table and, with --json <file>, writes the results in Google
+// Benchmark's JSON layout so runs can be compared across releases.
+//
+//   ./op_bench [--max-size <n>] [--min-time <seconds>] [--json <file>]
+
+struct Result
+{
+    std::string name;
+    size_t iterations;
+    double ns_per_op;
+};
+
+static std::vector<Result> results;
+static size_t max_size = 10000000;
+static double min_time = 0.02;
+static uint64_t sink = 0;
+
+// Repeat body (one pass over size elements) until min_time has elapsed
+template <class Body>
+void measure(const std::string &name, size_t size, Body body)
+{
+    size_t passes = 0;
+    double elapsed = 0;
+    auto start = std::chrono::steady_clock::now();
+    do
+    {
+        body();
+        ++passes;
+        elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (elapsed < min_time);
+
+    Result result{name + "/" + std::to_string(size), passes * size, elapsed * 1e9 / (passes * size)};
+    std::cout << std::left << std::setw(40) << result.name
+              << std::setw(12) << result.ns_per_op << "ns/op  "
+              << 1e3 / result.ns_per_op << " M op/s\n";
+    results.push_back(result);
+}
+
+template <class FP>
+uint64_t bits_of(const FP &value)
+{
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(FP));
+    return bits;
+}
+
+template <class FP>
+std::vector<FP> random_values(size_t size, uint64_t seed)
+{
+    std::mt19937_64 gen(seed);
+    std::uniform_real_distribution<double> dist(-8.0, 8.0);
+    std::vector<FP> values(size);
+    for (FP &value : values)
+        value = FP(dist(gen));
+    return values;
+}
+
+template <class FP, class To>
+void bench_convert(const std::string &name, const std::string &to_name, size_t size)
+{
+    std::vector<FP> a = random_values<FP>(size, 1);
+    std::vector<To> out(size);
+    measure("convert/" + name + "->" + to_name, size, [&]
+            {
+        for (size_t i = 0; i < size; ++i)
+            out[i] = To(a[i]);
+        sink += bits_of(out[size - 1]); });
+}
+
+template <class FP>
+void bench_format(const std::string &name, size_t size)
+{
+    std::vector<FP> a = random_values<FP>(size, 1);
+    std::vector<FP> b = random_values<FP>(size, 2);
+    std::vector<FP> out(size);
+
+    std::mt19937_64 gen(3);
+    std::vector<int> ints(size);
+    std::vector<float> floats(size);
+    std::vector<double> doubles(size);
+    for (size_t i = 0; i < size; ++i)
+    {
+        ints[i] = static_cast<int>(gen() % 2001) - 1000;
+        doubles[i] = static_cast<double>(ints[i]) / 7.0;
+        floats[i] = static_cast<float>(doubles[i]);
+    }
+
+    measure("from_int/" + name, size, [&]
+            {
+        for (size_t i = 0; i < size; ++i)
+            out[i] = FP(ints[i]);
+        sink += bits_of(out[size - 1]); });
+    measure("from_float/" + name, size, [&]
+            {
+        for (size_t i = 0; i < size; ++i)
+            out[i] = FP(floats[i]);
+        sink += bits_of(out[size - 1]); });
+    measure("from_double/" + name, size, [&]
+            {
+        for (size_t i = 0; i < size; ++i)
+            out[i] = FP(doubles[i]);
+        sink += bits_of(out[size - 1]); });
+
+    bench_convert<FP, Half>(name, "Half", size);
+    bench_convert<FP, Float>(name, "Float", size);
+    bench_convert<FP, Double>(name, "Double", size);
+    bench_convert<FP, CA25>(name, "CA25", size);
+    std::vector<E4M3> narrow(size);
+    measure("convert/" + name + "->E4M3/batch", size, [&]
+            {
+        convert(std::span<const FP>(a), std::span<E4M3>(narrow));
+        sink += bits_of(narrow[size - 1]); });
+
+    measure("add/" + name + "/scalar", size, [&]
+            {
+        for (size_t i = 0; i < size; ++i)
+            out[i] = a[i] + b[i];
+        sink += bits_of(out[size - 1]); });
+    measure("add/" + name + "/batch", size, [&]
+            {
+        add(std::span<const FP>(a), std::span<const FP>(b), std::span<FP>(out));
+        sink += bits_of(out[size - 1]); });
+    measure("mul/" + name + "/scalar", size, [&]
+            {
+        for (size_t i = 0; i < size; ++i)
+            out[i] = a[i] * b[i];
+        sink += bits_of(out[size - 1]); });
+    measure("mul/" + name + "/batch", size, [&]
+            {
+        mul(std::span<const FP>(a), std::span<const FP>(b), std::span<FP>(out));
+        sink += bits_of(out[size - 1]); });
+
+    measure("equal/" + name, size, [&]
+            {
+        size_t count = 0;
+        for (size_t i = 0; i < size; ++i)
+            count += a[i] == b[i];
+        sink += count; });
+    measure("less/" + name, size, [&]
+            {
+        size_t count = 0;
+        for (size_t i = 0; i < size; ++i)
+            count += a[i] < b[i];
+        sink += count; });
+
+    measure("exp/" + name, size, [&]
+            {
+        for (size_t i = 0; i < size; ++i)
+            out[i] = a[i].exp();
+        sink += bits_of(out[size - 1]); });
+    measure("log/" + name, size, [&]
+            {
+        for (size_t i = 0; i < size; ++i)
+            out[i] = abs(a[i]).log();
+        sink += bits_of(out[size - 1]); });
+    measure("pow/" + name, size, [&]
+            {
+        for (size_t i = 0; i < size; ++i)
+            out[i] = abs(a[i]).pow(b[i]);
+        sink += bits_of(out[size - 1]); });
+    if constexpr (FP::E_length + FP::M_length + 1 <= 16)
+    {
+        measure("exp/" + name + "/table", size, [&]
+                {
+            lut::exp(std::span<const FP>(a), std::span<FP>(out));
+            sink += bits_of(out[size - 1]); });
+    }
+    measure("to_decimal/" + name, size, [&]
+            {
+        double total = 0;
+        for (size_t i = 0; i < size; ++i)
+            total += a[i].To_decimal();
+        sink += static_cast<uint64_t>(total); });
+}
+
+void write_json(const std::string &path)
+{
+    std::ofstream file(path);
+    file << "{\n  \"context\": {\n"
+         << "    \"executable\": \"op_bench\",\n"
+         << "    \"max_size\": " << max_size << ",\n"
+         << "    \"min_time\": " << min_time << "\n"
+         << "  },\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &result = results[i];
+        file << "    {\"name\": \"" << result.name << "\", \"run_type\": \"iteration\""
+             << ", \"iterations\": " << result.iterations
+             << ", \"real_time\": " << result.ns_per_op
+             << ", \"cpu_time\": " << result.ns_per_op
+             << ", \"time_unit\": \"ns\""
+             << ", \"items_per_second\": " << 1e9 / result.ns_per_op << "}"
+             << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    file << "  ]\n}\n";
+}
+
+int main(int argc, char **argv)
+{
+    std::string json_path;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        std::string option = argv[i];
+        if (option == "--max-size")
+            max_size = std::strtoull(argv[i + 1], nullptr, 10);
+        else if (option == "--min-time")
+            min_time = std::strtod(argv[i + 1], nullptr);
+        else if (option == "--json")
+            json_path = argv[i + 1];
+    }
+
+    for (size_t size = 1; size <= max_size; size *= 10)
+    {
+        bench_format<Half>("Half", size);
+        bench_format<Float>("Float", size);
+        bench_format<Double>("Double", size);
+        bench_format<CA25>("CA25", size);
+    }
+
+    if (!json_path.empty())
+    {
+        write_json(json_path);
+    }
+    std::cout << "checksum " << sink << "\n";
+
+    return 0;
+}
@@ -0,0 +1,486 @@
+#include "../Utils/Ftype.hpp"
+#include "../Utils/Batch.hpp"
+#include "../Utils/Expression.hpp"
+#include <bit>
+#include <cfenv>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <span>
+#include <vector>
+
+// Self-checking test of the arithmetic. Prints the first failing cases and the number
+// of failures of every check, and exits with 1 when any check failed.
+//
+//  - div, sqrt and fma on Float and Double bit for bit against the host's float and
+//    double in every rounding mode, and their flags except underflow, which the host
+//    detects after rounding. The host has no ties-away mode: RoundNearestAway is
+//    checked against the host's round to nearest with exact ties, found in __float128,
+//    moved away from zero
+//  - Half add, sub, mul, div and sqrt in every rounding mode, for every Half against
+//    a set of second operands, against the host's float rounded to odd and then into
+//    Half; conversion into Half at every Half and every midpoint between two of them
+//  - every operation of FloatingPointUnpacked against the packed one, flags included
+//  - evaluate() against the same expression element by element, y = a * x + y with y
+//    evaluated in place included
+//
+// The host operations need -frounding-math to stay between the fesetround() calls.
+
+static std::mt19937_64 rng(2024);
+static int failures = 0;
+
+static bool fail(int &count)
+{
+    ++count;
+    return failures++ < 20;
+}
+
+static int report(const char *check, int count)
+{
+    std::printf("%-48s %s (%d failures)\n", check, count == 0 ? "ok" : "FAILED", count);
+    return count;
+}
+
+template <class FP>
+static unsigned long long bits(const FP &value)
+{
+    return static_cast<unsigned long long>(value.to_bits());
+}
+
+// Same encoding, or NaNs both
+template <class FP>
+static bool same(const FP &a, const FP &b)
+{
+    return a.to_bits() == b.to_bits() || (a.get_state() == Nan && b.get_state() == Nan);
+}
+
+/* Float and Double against the host */
+
+template <class FP>
+struct host_of;
+template <>
+struct host_of<Float>
+{
+    using type = float;
+};
+template <>
+struct host_of<Double>
+{
+    using type = double;
+};
+
+static int host_rounding(Rounding mode)
+{
+    switch (mode)
+    {
+    case RoundTowardZero:
+        return FE_TOWARDZERO;
+    case RoundUpward:
+        return FE_UPWARD;
+    case RoundDownward:
+        return FE_DOWNWARD;
+    default:
+        return FE_TONEAREST;
+    }
+}
+
+static unsigned host_flags()
+{
+    const int raised = std::fetestexcept(FE_ALL_EXCEPT);
+    return (raised & FE_INVALID ? FlagInvalid : 0) | (raised & FE_DIVBYZERO ? FlagDivideByZero : 0) |
+           (raised & FE_OVERFLOW ? FlagOverflow : 0) | (raised & FE_INEXACT ? FlagInexact : 0);
+}
+
+// Operands over the whole encoding, near one, with short significands so that ties
+// and exact results come up, and powers of two
+template <class FP>
+static FP operand()
+{
+    using Storage = typename FP::storage_type;
+    const uint64_t sign = rng() & 1;
+    const uint64_t exponent_mask = (1ULL << FP::E_length) - 1;
+    const uint64_t mantissa_mask = (1ULL << FP::M_length) - 1;
+    uint64_t exponent = (exponent_mask >> 1) + rng() % 61 - 30;
+    uint64_t mantissa = rng() & mantissa_mask;
+    switch (rng() % 5)
+    {
+    case 0:
+        return FP::from_bits(static_cast<Storage>(rng()));
+    case 1:
+        mantissa &= ~(mantissa_mask >> 3);
+        break;
+    case 2:
+        mantissa = 0;
+        exponent = rng() % exponent_mask;
+        break;
+    case 3:
+        exponent = rng() % 4;
+        break;
+    }
+    return FP::from_bits(static_cast<Storage>((sign << (FP::E_length + FP::M_length)) | (exponent << FP::M_length) | mantissa));
+}
+
+// The host's round-to-nearest result moved away from zero when the exact value, told
+// by is_tie(), lies halfway between it and its neighbour away from zero
+template <class Host, class IsTie>
+static Host away_on_tie(Host nearest, IsTie is_tie)
+{
+    if (!std::isfinite(nearest))
+    {
+        return nearest;
+    }
+    const Host away = std::nextafter(nearest, std::copysign(std::numeric_limits<Host>::infinity(), nearest));
+    if (std::isinf(away))
+    {
+        return nearest;
+    }
+    const __float128 midpoint = (static_cast<__float128>(nearest) + away) / 2;
+    return is_tie(midpoint) ? away : nearest;
+}
+
+template <class FP, Rounding mode>
+static void check_host(const std::vector<FP> &a, const std::vector<FP> &b, const std::vector<FP> &c, int &count)
+{
+    using Host = typename host_of<FP>::type;
+    auto to_host = [](const FP &value)
+    { return std::bit_cast<Host>(value.to_bits()); };
+    auto from_host = [](Host value)
+    { return FP::from_bits(std::bit_cast<typename FP::storage_type>(value)); };
+
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        const Host x = to_host(a[i]), y = to_host(b[i]), z = to_host(c[i]);
+        Host expected[3];
+        unsigned expected_flags[3];
+        std::fesetround(host_rounding(mode));
+        std::feclearexcept(FE_ALL_EXCEPT);
+        expected[0] = x / y;
+        expected_flags[0] = host_flags();
+        std::feclearexcept(FE_ALL_EXCEPT);
+        expected[1] = std::sqrt(x);
+        expected_flags[1] = host_flags();
+        std::feclearexcept(FE_ALL_EXCEPT);
+        expected[2] = std::fma(x, y, z);
+        expected_flags[2] = host_flags();
+        std::fesetround(FE_TONEAREST);
+
+        if constexpr (mode == RoundNearestAway)
+        {
+            // all products below are exact in the 113 bits of __float128
+            expected[0] = away_on_tie(expected[0], [&](__float128 m)
+                                      { return m * y == x; });
+            expected[1] = away_on_tie(expected[1], [&](__float128 m)
+                                      { return m * m == x; });
+            expected[2] = away_on_tie(expected[2], [&](__float128 m)
+                                      {
+                // x * y + z == m, with the sum split exactly into sum + error
+                const __float128 product = static_cast<__float128>(x) * y;
+                const __float128 sum = product + z;
+                const __float128 part = sum - product;
+                const __float128 error = (product - (sum - part)) + (z - part);
+                return sum == m && error == 0; });
+        }
+
+        FP got[3];
+        unsigned got_flags[3];
+        clear_flags();
+        got[0] = a[i].template div<mode>(b[i]);
+        got_flags[0] = test_flags(FlagAll & ~FlagUnderflow);
+        clear_flags();
+        got[1] = a[i].template sqrt<mode>();
+        got_flags[1] = test_flags(FlagAll & ~FlagUnderflow);
+        clear_flags();
+        got[2] = a[i].template fma<mode>(b[i], c[i]);
+        got_flags[2] = test_flags(FlagAll & ~FlagUnderflow);
+
+        static const char *const names[] = {"div", "sqrt", "fma"};
+        for (int op = 0; op < 3; ++op)
+        {
+            if ((!same(got[op], from_host(expected[op])) || got_flags[op] != expected_flags[op]) && fail(count))
+            {
+                std::printf("  %s E%dM%d mode %d: %llx %llx %llx gives %llx flags %x, host %llx flags %x\n",
+                            names[op], FP::E_length, FP::M_length, static_cast<int>(mode), bits(a[i]), bits(b[i]), bits(c[i]),
+                            bits(got[op]), got_flags[op], bits(from_host(expected[op])), expected_flags[op]);
+            }
+        }
+    }
+}
+
+template <class FP>
+static void check_host(size_t count_per_mode, int &count)
+{
+    std::vector<FP> a(count_per_mode), b(count_per_mode), c(count_per_mode);
+    for (size_t i = 0; i < count_per_mode; ++i)
+    {
+        a[i] = operand<FP>();
+        b[i] = operand<FP>();
+        // every fourth addend cancels the product nearly, or exactly
+        c[i] = i % 4 == 0 ? a[i].mul(b[i]).neg() : operand<FP>();
+    }
+    check_host<FP, RoundNearestEven>(a, b, c, count);
+    check_host<FP, RoundTowardZero>(a, b, c, count);
+    check_host<FP, RoundUpward>(a, b, c, count);
+    check_host<FP, RoundDownward>(a, b, c, count);
+    check_host<FP, RoundNearestAway>(a, b, c, count);
+}
+
+/* Half, exhaustively */
+
+// a op b on the host's float toward zero and rounded to odd: float has more than
+// 11 + 2 bits and the range of every result of two Halves, so rounding that into Half
+// in any mode rounds the exact result. An exact zero takes its sign from the mode.
+// The operands and the result go through volatiles, which keeps the compiler from
+// reusing the first result in the second mode.
+template <Rounding mode, class Op>
+static Half round_to_odd(Op op, float x, float y = 0)
+{
+    volatile float a = x, b = y, result;
+    std::fesetround(FE_TOWARDZERO);
+    std::feclearexcept(FE_INEXACT);
+    result = op(a, b);
+    const bool inexact = std::fetestexcept(FE_INEXACT);
+    if (result == 0)
+    {
+        std::fesetround(host_rounding(mode));
+        result = op(a, b);
+    }
+    std::fesetround(FE_TONEAREST);
+    const float value = result;
+    return Float::from_bits(std::bit_cast<uint32_t>(value) | (inexact && !std::isnan(value) ? 1u : 0u)).template to<Half, mode>();
+}
+
+template <Rounding mode>
+static void check_half(const std::vector<Half> &second, int &count)
+{
+    for (uint32_t code = 0; code < 0x10000; ++code)
+    {
+        const Half a = Half::from_bits(static_cast<uint16_t>(code));
+        const float x = a.to_float();
+        const Half root = round_to_odd<mode>([](float x, float)
+                                             { return std::sqrt(x); }, x);
+        if (!same(a.template sqrt<mode>(), root) && fail(count))
+        {
+            std::printf("  sqrt Half mode %d: %x\n", static_cast<int>(mode), code);
+        }
+        for (const Half &b : second)
+        {
+            const float y = b.to_float();
+            const Half expected[] = {
+                round_to_odd<mode>([](float x, float y)
+                                   { return x + y; }, x, y),
+                round_to_odd<mode>([](float x, float y)
+                                   { return x - y; }, x, y),
+                round_to_odd<mode>([](float x, float y)
+                                   { return x * y; }, x, y),
+                round_to_odd<mode>([](float x, float y)
+                                   { return x / y; }, x, y),
+            };
+            const Half got[] = {a.template add<mode>(b), a.template sub<mode>(b), a.template mul<mode>(b), a.template div<mode>(b)};
+            for (int op = 0; op < 4; ++op)
+            {
+                if (!same(got[op], expected[op]) && fail(count))
+                {
+                    static const char *const names[] = {"add", "sub", "mul", "div"};
+                    std::printf("  %s Half mode %d: %x %llx gives %llx, expected %llx\n", names[op], static_cast<int>(mode),
+                                code, bits(b), bits(got[op]), bits(expected[op]));
+                }
+            }
+        }
+    }
+}
+
+// Float into Half at every Half h, at the midpoint m between h and the next Half n,
+// and one Float either side of m
+template <Rounding mode>
+static void check_half_conversion(int &count)
+{
+    for (uint32_t code = 0; code < 0x7c00; ++code)
+    {
+        const Half h = Half::from_bits(static_cast<uint16_t>(code));
+        const Half n = Half::from_bits(static_cast<uint16_t>(code + 1));
+        // past the largest Half, the midpoint is the overflow threshold 65520
+        const float m = (h.to_float() + (n.get_state() == Inf ? 65536.0f : n.to_float())) / 2;
+        const float values[] = {h.to_float(), std::nextafter(m, 0.0f), m, std::nextafter(m, 1e30f)};
+        for (int i = 0; i < 4; ++i)
+        {
+            for (int sign = 0; sign < 2; ++sign)
+            {
+                // the magnitude rounded in the mode as seen from the sign
+                bool up = mode == RoundUpward ? !sign : mode == RoundDownward ? sign
+                                                                              : false;
+                if (mode == RoundNearestEven || mode == RoundNearestAway)
+                {
+                    up = i == 3 || (i == 2 && (mode == RoundNearestAway || (code & 1)));
+                }
+                up = up && i != 0;
+                const Half magnitude = up ? n : h;
+                const Half expected = sign ? magnitude.neg() : magnitude;
+                const Float value = Float(static_cast<double>(sign ? -values[i] : values[i]));
+                const Half got = value.template to<Half, mode>();
+                if (got.to_bits() != expected.to_bits() && fail(count))
+                {
+                    std::printf("  Float %llx into Half mode %d gives %llx, expected %llx\n", bits(value), static_cast<int>(mode),
+                                bits(got), bits(expected));
+                }
+            }
+        }
+    }
+}
+
+/* FloatingPointUnpacked against the packed operations */
+
+template <class FP, Rounding mode>
+static void check_unpacked(size_t n, int &count)
+{
+    using U = FloatingPointUnpacked;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const FP a = operand<FP>(), b = operand<FP>(), c = operand<FP>();
+        auto check = [&](const char *op, auto packed, auto unpacked)
+        {
+            clear_flags();
+            const FP expected = packed();
+            const unsigned expected_flags = test_flags();
+            clear_flags();
+            const FP got = unpacked().template to<FP, mode>();
+            const unsigned got_flags = test_flags();
+            if ((got.to_bits() != expected.to_bits() || got_flags != expected_flags) && fail(count))
+            {
+                std::printf("  unpacked %s E%dM%d mode %d: %llx %llx %llx gives %llx flags %x, packed %llx flags %x\n", op,
+                            FP::E_length, FP::M_length, static_cast<int>(mode), bits(a), bits(b), bits(c), bits(got), got_flags,
+                            bits(expected), expected_flags);
+            }
+        };
+        check("add", [&]
+              { return a.template add<mode>(b); }, [&]
+              { return U(a) + b; });
+        check("sub", [&]
+              { return a.template sub<mode>(b); }, [&]
+              { return U(a) - b; });
+        check("mul", [&]
+              { return a.template mul<mode>(b); }, [&]
+              { return U(a) * b; });
+        check("fma", [&]
+              { return a.template fma<mode>(b, c); }, [&]
+              { return fma(U(a), b, c); });
+    }
+}
+
+template <class FP>
+static void check_unpacked(size_t n, int &count)
+{
+    check_unpacked<FP, RoundNearestEven>(n, count);
+    check_unpacked<FP, RoundTowardZero>(n, count);
+    check_unpacked<FP, RoundUpward>(n, count);
+    check_unpacked<FP, RoundDownward>(n, count);
+    check_unpacked<FP, RoundNearestAway>(n, count);
+}
+
+/* evaluate() against the operators */
+
+template <class FP>
+static void check_expression(size_t n, int &count)
+{
+    std::vector<FP> a(n), b(n), x(n), y(n), out(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        a[i] = operand<FP>();
+        b[i] = operand<FP>();
+        x[i] = operand<FP>();
+        y[i] = operand<FP>();
+    }
+    const FP s(0.75);
+    auto compare = [&](const char *what, const std::vector<FP> &got, auto expected)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            const FP e = expected(i);
+            if (got[i].to_bits() != e.to_bits() && fail(count))
+            {
+                std::printf("  evaluate %s E%dM%d at %zu gives %llx, expected %llx\n", what, FP::E_length, FP::M_length, i,
+                            bits(got[i]), bits(e));
+            }
+        }
+    };
+
+    clear_flags();
+    evaluate(s * lazy(a) + lazy(b) * lazy(x) - lazy(y) / lazy(b), std::span<FP>(out));
+    const unsigned lazy_flags = test_flags();
+    clear_flags();
+    compare("s*a + b*x - y/b", out, [&](size_t i)
+            { return s * a[i] + b[i] * x[i] - y[i] / b[i]; });
+    if (test_flags() != lazy_flags && fail(count))
+    {
+        std::printf("  evaluate E%dM%d raises %x, the operators %x\n", FP::E_length, FP::M_length, lazy_flags, test_flags());
+    }
+
+    evaluate(sqrt(lazy(a)) - (-lazy(x)) + s, std::span<FP>(out));
+    compare("sqrt(a) - -x + s", out, [&](size_t i)
+            { return a[i].sqrt() - (-x[i]) + s; });
+    evaluate<RoundTowardZero>(lazy(a) * lazy(x) + lazy(y), std::span<FP>(out));
+    compare("a*x + y toward zero", out, [&](size_t i)
+            { return a[i].template mul<RoundTowardZero>(x[i]).template add<RoundTowardZero>(y[i]); });
+    evaluate<RoundNearestEven, ContractFma>(lazy(a) * lazy(x) - lazy(y), std::span<FP>(out));
+    compare("a*x - y contracted", out, [&](size_t i)
+            { return fma(a[i], x[i], -y[i]); });
+
+    // y = a * x + y and y = s * x + y, in place
+    const std::vector<FP> y0 = y;
+    evaluate(lazy(a) * lazy(x) + lazy(y), std::span<FP>(y));
+    compare("y = a*x + y in place", y, [&](size_t i)
+            { return a[i] * x[i] + y0[i]; });
+    y = y0;
+    evaluate<RoundNearestEven, ContractFma>(lazy(a) * lazy(x) + lazy(y), std::span<FP>(y));
+    compare("y = a*x + y in place, contracted", y, [&](size_t i)
+            { return fma(a[i], x[i], y0[i]); });
+    y = y0;
+    evaluate<RoundNearestEven, ContractFma>(s * lazy(x) + lazy(y), std::span<FP>(y));
+    compare("y = s*x + y in place, contracted", y, [&](size_t i)
+            { return fma(s, x[i], y0[i]); });
+}
+
+int main()
+{
+    int host = 0, half = 0, conversion = 0, unpacked = 0, expression = 0;
+
+    check_host<Float>(200000, host);
+    check_host<Double>(200000, host);
+
+    std::vector<Half> second = {Half(0.0), Half(-0.0), Half(1.0), Half(-1.0), Half(0.5), Half(3.0), Half(65504.0),
+                                Half::from_bits(1), Half::from_bits(0x83ff), Half::from_bits(0x0400), Half::createInfinity(false),
+                                Half::createInfinity(true), Half::createNaN()};
+    while (second.size() < 64)
+    {
+        second.push_back(operand<Half>());
+    }
+    check_half<RoundNearestEven>(second, half);
+    check_half<RoundTowardZero>(second, half);
+    check_half<RoundUpward>(second, half);
+    check_half<RoundDownward>(second, half);
+    check_half<RoundNearestAway>(second, half);
+    check_half_conversion<RoundNearestEven>(conversion);
+    check_half_conversion<RoundTowardZero>(conversion);
+    check_half_conversion<RoundUpward>(conversion);
+    check_half_conversion<RoundDownward>(conversion);
+    check_half_conversion<RoundNearestAway>(conversion);
+
+    check_unpacked<Half>(20000, unpacked);
+    check_unpacked<BFloat16>(20000, unpacked);
+    check_unpacked<E4M3>(20000, unpacked);
+    check_unpacked<Float>(20000, unpacked);
+    check_unpacked<Double>(20000, unpacked);
+
+    check_expression<Half>(5000, expression);
+    check_expression<BFloat16>(5000, expression);
+    check_expression<E4M3>(5000, expression);
+    check_expression<Float>(5000, expression);
+    check_expression<Double>(5000, expression);
+
+    report("div, sqrt, fma against the host", host);
+    report("Half against the host's float", half);
+    report("conversion into Half", conversion);
+    report("unpacked against packed", unpacked);
+    report("evaluate() against the operators", expression);
+    return failures == 0 ? 0 : 1;
+}
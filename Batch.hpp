@@ -0,0 +1,1329 @@
+#ifndef BATCH_HPP_
+#define BATCH_HPP_
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <barrier>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <thread>
+#include <vector>
+#include "FloatingPoint_1.hpp"
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__F16C__))
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <xmmintrin.h>
+#else
+#include <cfenv>
+#endif
+
+// Element-wise kernels over arrays of emulated values.
+//
+// Half, Float and Double run on host SIMD lanes when the target has them (AVX-512, or
+// AVX2 with F16C). Every other format, the tail of the array, and any block of lanes
+// that produced a NaN go through the scalar routines, so the output is bit-identical
+// to calling the operators one element at a time. Division of formats without host
+// lanes replaces the integer divide by a table-seeded Newton-Raphson reciprocal
+// estimated a block at a time, corrected on the exact remainder; square root does the
+// same with the host root of the significand. All paths raise the sticky flags of the
+// scalar routines (see test_flags()); the host lanes report underflow by the host's rule.
+// The kernels take every format, with its traits: the FP8, FP6 and FP4 aliases of
+// Ftype.hpp included.
+//
+// Rounding modes other than the default run the scalar routines. Under RoundStochastic
+// element i of a call takes draw counter + i of the calling thread's stream and the
+// counter then moves past the call, so the results depend only on the seed and the
+// element positions, not on how the work is split between threads.
+
+namespace batch_detail
+{
+    struct Add
+    {
+        template <class FP, Rounding mode = RoundNearestEven>
+        static FP scalar(const FP &a, const FP &b) { return a.template add<mode>(b); }
+#if defined(__AVX512F__)
+        static __m512 lanes(__m512 a, __m512 b) { return _mm512_add_ps(a, b); }
+        static __m512d lanes(__m512d a, __m512d b) { return _mm512_add_pd(a, b); }
+#elif defined(__AVX2__) && defined(__F16C__)
+        static __m256 lanes(__m256 a, __m256 b) { return _mm256_add_ps(a, b); }
+        static __m256d lanes(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+#endif
+    };
+
+    struct Mul
+    {
+        template <class FP, Rounding mode = RoundNearestEven>
+        static FP scalar(const FP &a, const FP &b) { return a.template mul<mode>(b); }
+#if defined(__AVX512F__)
+        static __m512 lanes(__m512 a, __m512 b) { return _mm512_mul_ps(a, b); }
+        static __m512d lanes(__m512d a, __m512d b) { return _mm512_mul_pd(a, b); }
+#elif defined(__AVX2__) && defined(__F16C__)
+        static __m256 lanes(__m256 a, __m256 b) { return _mm256_mul_ps(a, b); }
+        static __m256d lanes(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+#endif
+    };
+
+    // The host fma rounds once, as fma() does, so Float and Double lanes are exact. Half
+    // lanes round the float result a second time, which only goes wrong when the float
+    // result lands on a midpoint of half: host_lanes::rounds_twice() finds those lanes
+    // and they are redone by the scalar routine
+    struct Fma
+    {
+        template <class FP, Rounding mode = RoundNearestEven>
+        static FP scalar(const FP &a, const FP &b, const FP &c) { return a.template fma<mode>(b, c); }
+#if defined(__AVX512F__)
+        static __m512 lanes(__m512 a, __m512 b, __m512 c) { return _mm512_fmadd_ps(a, b, c); }
+        static __m512d lanes(__m512d a, __m512d b, __m512d c) { return _mm512_fmadd_pd(a, b, c); }
+#elif defined(__AVX2__) && defined(__F16C__) && defined(__FMA__)
+        static __m256 lanes(__m256 a, __m256 b, __m256 c) { return _mm256_fmadd_ps(a, b, c); }
+        static __m256d lanes(__m256d a, __m256d b, __m256d c) { return _mm256_fmadd_pd(a, b, c); }
+#endif
+    };
+
+    // 2^25 / (513 + 2i) / 2^15: 1/D for D in the middle of the i-th of 256 buckets of
+    // normalized divisors D in [0.5, 1), good to about 9 bits
+    inline constexpr std::array<double, 256> reciprocal_seed = []
+    {
+        std::array<double, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t divisor = 513 + 2 * i;
+            table[i] = static_cast<double>(((1u << 25) + divisor / 2) / divisor) / 32768.0;
+        }
+        return table;
+    }();
+
+    // Conversions between doubles and integers below 2^52 through the 2^52 bias; unlike the
+    // int64 conversions these have AVX2 forms. double_to_small() rounds to nearest.
+    inline double small_to_double(uint64_t value)
+    {
+        return std::bit_cast<double>(value | 0x4330000000000000ULL) - 4503599627370496.0;
+    }
+    inline uint64_t double_to_small(double value)
+    {
+        return std::bit_cast<uint64_t>(value + 4503599627370496.0) & 0xFFFFFFFFFFFFFULL;
+    }
+
+    // Division for formats without host lanes, one block at a time. For normal operands
+    // with a normal quotient everything runs straight-line on the encodings, so the loop
+    // maps onto vector lanes: the divisor's reciprocal is seeded from the table and refined
+    // by Newton-Raphson steps x += x * (1 - d * x) in double, the quotient estimate is
+    // settled on its exact integer remainder, then rounded to nearest even and packed.
+    // Every other element is handed to div(). Returns how many elements were done.
+    template <class FP, bool unit_dividend>
+    size_t newton_div(const FP *a, const FP *b, FP *out, size_t n)
+    {
+        constexpr int mantissa = FP::M_length;
+        constexpr int exponent = FP::E_length;
+        constexpr uint64_t E_mask = FP::E_mask;
+        constexpr uint64_t M_mask = FP::M_mask;
+        constexpr int64_t bias = FP::E_bias;
+
+        // The quotient estimate must stay well inside a double's 53 bits
+        if constexpr (mantissa > 45)
+        {
+            return 0;
+        }
+        else
+        {
+            using storage_type = typename FP::storage_type;
+            const storage_type *a_bits = reinterpret_cast<const storage_type *>(a);
+            const storage_type *b_bits = reinterpret_cast<const storage_type *>(b);
+
+            // Same quotient as div(): dividend * 2^(mantissa + 3) / divisor
+            constexpr int quotient_shift = mantissa + 3;
+            constexpr double quotient_scale = static_cast<double>(1ULL << quotient_shift);
+            constexpr double seed_scale = 1.0 / static_cast<double>(1ULL << (1 + mantissa));
+            constexpr int newton_steps = (mantissa + 6 <= 18) ? 1 : (mantissa + 6 <= 36) ? 2 : 3;
+            constexpr size_t block = 64;
+
+            uint64_t inexact = 0, overflow = 0;
+            size_t i = 0;
+            for (; i + block <= n; i += block)
+            {
+                uint64_t result[block];
+                uint64_t done[block];
+
+                for (size_t k = 0; k < block; ++k)
+                {
+                    const uint64_t x_bits = unit_dividend ? static_cast<uint64_t>(bias) << mantissa : a_bits[i + k];
+                    const uint64_t y_bits = b_bits[i + k];
+                    const uint64_t E1 = (x_bits >> mantissa) & E_mask;
+                    const uint64_t E2 = (y_bits >> mantissa) & E_mask;
+                    const uint64_t dividend = (x_bits & M_mask) | (M_mask + 1);
+                    const uint64_t divisor = (y_bits & M_mask) | (M_mask + 1);
+
+                    // the eight bits below the leading one pick the seed
+                    uint64_t index;
+                    if constexpr (mantissa >= 8)
+                        index = (divisor >> (mantissa - 8)) & 0xFF;
+                    else
+                        index = (divisor << (8 - mantissa)) & 0xFF;
+                    const double d = small_to_double(divisor);
+                    double x = reciprocal_seed[index] * seed_scale;
+                    for (int step = 0; step < newton_steps; ++step)
+                    {
+                        x += x * (1.0 - d * x);
+                    }
+                    uint64_t quotient = double_to_small(small_to_double(dividend) * quotient_scale * x);
+
+                    // The estimate is off by at most a unit; settle it on the exact remainder,
+                    // which is small enough to be computed modulo 2^64
+                    int64_t remainder = static_cast<int64_t>((dividend << quotient_shift) - quotient * divisor);
+                    const uint64_t low = remainder < 0;
+                    quotient -= low;
+                    remainder += static_cast<int64_t>(divisor & (0 - low));
+                    const uint64_t high = remainder >= static_cast<int64_t>(divisor);
+                    quotient += high;
+                    remainder -= static_cast<int64_t>(divisor & (0 - high));
+
+                    // quotient is in [2^(mantissa + 2), 2^(mantissa + 4)): keep mantissa + 1 bits
+                    // (selects rather than a variable shift, which keeps the loop vectorizable)
+                    const uint64_t top = quotient >> (mantissa + 3);
+                    uint64_t kept = top ? quotient >> 3 : quotient >> 2;
+                    const uint64_t half = (top ? quotient >> 2 : quotient >> 1) & 1;
+                    const uint64_t rest = ((quotient & (top ? 3 : 1)) | static_cast<uint64_t>(remainder)) != 0;
+                    kept += half & (rest | (kept & 1));
+
+                    const int64_t E_value = static_cast<int64_t>(E1) - static_cast<int64_t>(E2) + bias - 1 + static_cast<int64_t>(top);
+                    const uint64_t sign = ((x_bits ^ y_bits) >> (exponent + mantissa)) & 1;
+                    result[k] = (sign << (exponent + mantissa)) + (static_cast<uint64_t>(E_value - 1) << mantissa) + kept;
+                    done[k] = (E1 - 1 < E_mask - 1) & (E2 - 1 < E_mask - 1) &
+                              (static_cast<uint64_t>(E_value - 1) < E_mask - 1);
+                    inexact |= (half | rest) & done[k];
+                    overflow |= (((result[k] >> mantissa) & E_mask) == E_mask) & done[k];
+                }
+
+                for (size_t k = 0; k < block; ++k)
+                {
+                    if (done[k])
+                    {
+                        out[i + k] = FP(result[k]);
+                    }
+                    else
+                    {
+                        out[i + k] = unit_dividend ? FP(1).div(b[i + k]) : a[i + k].div(b[i + k]);
+                    }
+                }
+            }
+            // A rounding carry out of the largest binade encodes infinity by itself
+            raise_flags((overflow ? FlagOverflow : 0) | (inexact ? FlagInexact : 0));
+            return i;
+        }
+    }
+
+    // Square root for formats without host lanes, one block at a time. For positive normal
+    // inputs the root is estimated by the host sqrt of the significand, settled on its
+    // exact integer remainder as in newton_div(), then rounded to nearest even and packed;
+    // the root of a normal is always normal. Every other element is handed to sqrt().
+    // The loop only maps onto vector lanes when std::sqrt need not set errno
+    // (-fno-math-errno).
+    template <class FP>
+    size_t block_sqrt(const FP *a, FP *out, size_t n)
+    {
+        constexpr int mantissa = FP::M_length;
+        constexpr int exponent = FP::E_length;
+        constexpr uint64_t E_mask = FP::E_mask;
+        constexpr uint64_t M_mask = FP::M_mask;
+        constexpr int64_t bias = FP::E_bias;
+
+        // The root estimate must stay well inside a double's 53 bits
+        if constexpr (mantissa > 45)
+        {
+            return 0;
+        }
+        else
+        {
+            using storage_type = typename FP::storage_type;
+            const storage_type *a_bits = reinterpret_cast<const storage_type *>(a);
+
+            // Same radicand as sqrt(): significand * 2^shift, shift = mantissa + 3 + odd
+            constexpr double even_scale = static_cast<double>(1ULL << (mantissa + 3));
+            constexpr double odd_scale = static_cast<double>(1ULL << (mantissa + 4));
+            constexpr size_t block = 64;
+
+            uint64_t inexact = 0;
+            size_t i = 0;
+            for (; i + block <= n; i += block)
+            {
+                uint64_t result[block];
+                uint64_t done[block];
+
+                for (size_t k = 0; k < block; ++k)
+                {
+                    const uint64_t x_bits = a_bits[i + k];
+                    const uint64_t E = (x_bits >> mantissa) & E_mask;
+                    const uint64_t sig = (x_bits & M_mask) | (M_mask + 1);
+
+                    // exp - shift has to be even, exp = E - bias - mantissa
+                    const uint64_t odd = static_cast<uint64_t>(static_cast<int64_t>(E) - bias - 1) & 1;
+                    const uint64_t radicand = odd ? sig << (mantissa + 4) : sig << (mantissa + 3);
+                    uint64_t root = double_to_small(std::sqrt(small_to_double(sig) * (odd ? odd_scale : even_scale)));
+
+                    // root is within a unit of the integer root; the remainder is small
+                    // enough to be computed modulo 2^64
+                    int64_t remainder = static_cast<int64_t>(radicand - root * root);
+                    const uint64_t low = remainder < 0;
+                    root -= low;
+                    remainder += static_cast<int64_t>((2 * root + 1) & (0 - low));
+                    const uint64_t high = remainder > static_cast<int64_t>(2 * root);
+                    remainder -= static_cast<int64_t>((2 * root + 1) & (0 - high));
+                    root += high;
+
+                    // root is in [2^(mantissa + 1.5), 2^(mantissa + 2.5)): keep mantissa + 1 bits
+                    uint64_t kept = odd ? root >> 2 : root >> 1;
+                    const uint64_t half = (odd ? root >> 1 : root) & 1;
+                    const uint64_t rest = ((root & odd) | static_cast<uint64_t>(remainder)) != 0;
+                    kept += half & (rest | (kept & 1));
+
+                    // (exp - shift) / 2 + leading one + bias, which simplifies to
+                    const uint64_t E_value = (E + bias - 1 + odd) / 2;
+                    result[k] = ((E_value - 1) << mantissa) + kept;
+                    done[k] = (E - 1 < E_mask - 1) & ((x_bits >> (exponent + mantissa)) == 0);
+                    inexact |= (half | rest) & done[k];
+                }
+
+                for (size_t k = 0; k < block; ++k)
+                {
+                    out[i + k] = done[k] ? FP(result[k]) : a[i + k].sqrt();
+                }
+            }
+            raise_flags(inexact ? FlagInexact : 0);
+            return i;
+        }
+    }
+
+    struct Div
+    {
+        template <class FP, Rounding mode = RoundNearestEven>
+        static FP scalar(const FP &a, const FP &b) { return a.template div<mode>(b); }
+        template <class FP>
+        static size_t block(const FP *a, const FP *b, FP *out, size_t n) { return newton_div<FP, false>(a, b, out, n); }
+#if defined(__AVX512F__)
+        static __m512 lanes(__m512 a, __m512 b) { return _mm512_div_ps(a, b); }
+        static __m512d lanes(__m512d a, __m512d b) { return _mm512_div_pd(a, b); }
+#elif defined(__AVX2__) && defined(__F16C__)
+        static __m256 lanes(__m256 a, __m256 b) { return _mm256_div_ps(a, b); }
+        static __m256d lanes(__m256d a, __m256d b) { return _mm256_div_pd(a, b); }
+#endif
+    };
+
+    struct Reciprocal
+    {
+        template <class FP, Rounding mode = RoundNearestEven>
+        static FP scalar(const FP &a) { return FP(1).template div<mode>(a); }
+        template <class FP>
+        static size_t block(const FP *a, FP *out, size_t n) { return newton_div<FP, true>(nullptr, a, out, n); }
+#if defined(__AVX512F__)
+        static __m512 lanes(__m512 a) { return _mm512_div_ps(_mm512_set1_ps(1.0f), a); }
+        static __m512d lanes(__m512d a) { return _mm512_div_pd(_mm512_set1_pd(1.0), a); }
+#elif defined(__AVX2__) && defined(__F16C__)
+        static __m256 lanes(__m256 a) { return _mm256_div_ps(_mm256_set1_ps(1.0f), a); }
+        static __m256d lanes(__m256d a) { return _mm256_div_pd(_mm256_set1_pd(1.0), a); }
+#endif
+    };
+
+    struct Sqrt
+    {
+        template <class FP, Rounding mode = RoundNearestEven>
+        static FP scalar(const FP &a) { return a.template sqrt<mode>(); }
+        template <class FP>
+        static size_t block(const FP *a, FP *out, size_t n) { return block_sqrt(a, out, n); }
+#if defined(__AVX512F__)
+        static __m512 lanes(__m512 a) { return _mm512_sqrt_ps(a); }
+        static __m512d lanes(__m512d a) { return _mm512_sqrt_pd(a); }
+#elif defined(__AVX2__) && defined(__F16C__)
+        static __m256 lanes(__m256 a) { return _mm256_sqrt_ps(a); }
+        static __m256d lanes(__m256d a) { return _mm256_sqrt_pd(a); }
+#endif
+    };
+
+    // The elementary functions have no lanes or block kernel: their 64 x 64 -> 128-bit
+    // products have no vector form, so every element takes the scalar routine
+    struct Exp
+    {
+        template <class FP, Rounding mode = RoundNearestEven>
+        static FP scalar(const FP &a) { return a.template exp<mode>(); }
+    };
+
+    struct Exp2
+    {
+        template <class FP, Rounding mode = RoundNearestEven>
+        static FP scalar(const FP &a) { return a.template exp2<mode>(); }
+    };
+
+    struct Log
+    {
+        template <class FP, Rounding mode = RoundNearestEven>
+        static FP scalar(const FP &a) { return a.template log<mode>(); }
+    };
+
+    struct Log2
+    {
+        template <class FP, Rounding mode = RoundNearestEven>
+        static FP scalar(const FP &a) { return a.template log2<mode>(); }
+    };
+
+    struct Pow
+    {
+        template <class FP, Rounding mode = RoundNearestEven>
+        static FP scalar(const FP &a, const FP &b) { return a.template pow<mode>(b); }
+    };
+
+    // How a format maps onto host vector lanes; formats without a host equivalent
+    // keep available == false and take the scalar loop
+    template <class FP>
+    struct host_lanes
+    {
+        static constexpr bool available = false;
+    };
+
+#if defined(__AVX512F__)
+    // Half is widened to binary32 lanes: 24 >= 2 * 11 + 2 bits, so rounding the float
+    // result a second time to half gives the correctly rounded half result
+    template <>
+    struct host_lanes<FloatingPoint<5, 10>>
+    {
+        static constexpr bool available = true;
+        static constexpr size_t width = 16;
+        static __m512 load(const void *p) { return _mm512_cvtph_ps(_mm256_loadu_si256(static_cast<const __m256i *>(p))); }
+        static void store(void *p, __m512 v)
+        {
+            _mm256_storeu_si256(static_cast<__m256i *>(p), _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+        }
+        static bool has_nan(__m512 v) { return _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q) != 0; }
+        // Lanes where rounding v, the float result of an operation the lanes do not hold
+        // exactly, to half could differ from rounding the exact result: v on a midpoint
+        // of half (bit 12 set and nothing below), or under half's normal range
+        static unsigned rounds_twice(__m512 v)
+        {
+            const __m512i bits = _mm512_castps_si512(v);
+            const __m512 magnitude = _mm512_abs_ps(v);
+            const __mmask16 midpoint = _mm512_cmpeq_epi32_mask(_mm512_and_si512(bits, _mm512_set1_epi32(0x1FFF)),
+                                                               _mm512_set1_epi32(0x1000));
+            const __mmask16 tiny = _mm512_cmp_ps_mask(magnitude, _mm512_set1_ps(0x1p-14f), _CMP_LT_OQ) &
+                                   _mm512_cmp_ps_mask(magnitude, _mm512_setzero_ps(), _CMP_NEQ_OQ);
+            return midpoint | tiny;
+        }
+    };
+
+    template <>
+    struct host_lanes<FloatingPoint<8, 23>>
+    {
+        static constexpr bool available = true;
+        static constexpr size_t width = 16;
+        static __m512 load(const void *p) { return _mm512_loadu_ps(p); }
+        static void store(void *p, __m512 v) { _mm512_storeu_ps(p, v); }
+        static bool has_nan(__m512 v) { return _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q) != 0; }
+        static unsigned rounds_twice(__m512) { return 0; }
+    };
+
+    template <>
+    struct host_lanes<FloatingPoint<11, 52>>
+    {
+        static constexpr bool available = true;
+        static constexpr size_t width = 8;
+        static __m512d load(const void *p) { return _mm512_loadu_pd(p); }
+        static void store(void *p, __m512d v) { _mm512_storeu_pd(p, v); }
+        static bool has_nan(__m512d v) { return _mm512_cmp_pd_mask(v, v, _CMP_UNORD_Q) != 0; }
+        static unsigned rounds_twice(__m512d) { return 0; }
+    };
+#elif defined(__AVX2__) && defined(__F16C__)
+    // Half is widened to binary32 lanes: 24 >= 2 * 11 + 2 bits, so rounding the float
+    // result a second time to half gives the correctly rounded half result
+    template <>
+    struct host_lanes<FloatingPoint<5, 10>>
+    {
+        static constexpr bool available = true;
+        static constexpr size_t width = 8;
+        static __m256 load(const void *p) { return _mm256_cvtph_ps(_mm_loadu_si128(static_cast<const __m128i *>(p))); }
+        static void store(void *p, __m256 v)
+        {
+            _mm_storeu_si128(static_cast<__m128i *>(p), _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT));
+        }
+        static bool has_nan(__m256 v) { return _mm256_movemask_ps(_mm256_cmp_ps(v, v, _CMP_UNORD_Q)) != 0; }
+        // Lanes where rounding v, the float result of an operation the lanes do not hold
+        // exactly, to half could differ from rounding the exact result: v on a midpoint
+        // of half (bit 12 set and nothing below), or under half's normal range
+        static unsigned rounds_twice(__m256 v)
+        {
+            const __m256i bits = _mm256_castps_si256(v);
+            const __m256 magnitude = _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+            const __m256i midpoint = _mm256_cmpeq_epi32(_mm256_and_si256(bits, _mm256_set1_epi32(0x1FFF)),
+                                                        _mm256_set1_epi32(0x1000));
+            const __m256 tiny = _mm256_and_ps(_mm256_cmp_ps(magnitude, _mm256_set1_ps(0x1p-14f), _CMP_LT_OQ),
+                                              _mm256_cmp_ps(magnitude, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+            return static_cast<unsigned>(_mm256_movemask_ps(_mm256_or_ps(_mm256_castsi256_ps(midpoint), tiny)));
+        }
+    };
+
+    template <>
+    struct host_lanes<FloatingPoint<8, 23>>
+    {
+        static constexpr bool available = true;
+        static constexpr size_t width = 8;
+        static __m256 load(const void *p) { return _mm256_loadu_ps(static_cast<const float *>(p)); }
+        static void store(void *p, __m256 v) { _mm256_storeu_ps(static_cast<float *>(p), v); }
+        static bool has_nan(__m256 v) { return _mm256_movemask_ps(_mm256_cmp_ps(v, v, _CMP_UNORD_Q)) != 0; }
+        static unsigned rounds_twice(__m256) { return 0; }
+    };
+
+    template <>
+    struct host_lanes<FloatingPoint<11, 52>>
+    {
+        static constexpr bool available = true;
+        static constexpr size_t width = 4;
+        static __m256d load(const void *p) { return _mm256_loadu_pd(static_cast<const double *>(p)); }
+        static void store(void *p, __m256d v) { _mm256_storeu_pd(static_cast<double *>(p), v); }
+        static bool has_nan(__m256d v) { return _mm256_movemask_pd(_mm256_cmp_pd(v, v, _CMP_UNORD_Q)) != 0; }
+        static unsigned rounds_twice(__m256d) { return 0; }
+    };
+#endif
+
+#if defined(__SSE2__)
+    // Collects the host exceptions raised while it is alive into the sticky flags of
+    // the thread. The half conversion reports its own overflow, underflow and inexact,
+    // so Half gets the flags of the half result; tininess is detected after rounding,
+    // as the host does, where the scalar routines detect it before. MXCSR is part of
+    // every x86-64 target, so the flags do not depend on the vector extensions enabled
+    class HostExceptions
+    {
+    public:
+        HostExceptions() : saved(_mm_getcsr()) { _mm_setcsr(saved & ~0x3Fu); }
+        ~HostExceptions()
+        {
+            const unsigned raised = _mm_getcsr();
+            raise_flags((raised & 0x01 ? FlagInvalid : 0) | (raised & 0x04 ? FlagDivideByZero : 0) |
+                        (raised & 0x08 ? FlagOverflow : 0) | (raised & 0x10 ? FlagUnderflow : 0) |
+                        (raised & 0x20 ? FlagInexact : 0));
+            _mm_setcsr(saved);
+        }
+
+    private:
+        unsigned saved;
+    };
+#else
+    // The same through <cfenv> on other hosts
+    class HostExceptions
+    {
+    public:
+        HostExceptions()
+        {
+            std::fegetexceptflag(&saved, FE_ALL_EXCEPT);
+            std::feclearexcept(FE_ALL_EXCEPT);
+        }
+        ~HostExceptions()
+        {
+            const int raised = std::fetestexcept(FE_ALL_EXCEPT);
+            raise_flags((raised & FE_INVALID ? FlagInvalid : 0) | (raised & FE_DIVBYZERO ? FlagDivideByZero : 0) |
+                        (raised & FE_OVERFLOW ? FlagOverflow : 0) | (raised & FE_UNDERFLOW ? FlagUnderflow : 0) |
+                        (raised & FE_INEXACT ? FlagInexact : 0));
+            std::fesetexceptflag(&saved, FE_ALL_EXCEPT);
+        }
+
+    private:
+        std::fexcept_t saved;
+    };
+#endif
+
+    // Process whole vectors and return how many elements were done. A vector holding a
+    // NaN is redone by the scalar routine, which decides which payload survives.
+    template <class Op, class Lanes, class FP>
+    size_t run_lanes(const FP *a, const FP *b, FP *out, size_t n)
+    {
+        HostExceptions exceptions;
+        size_t i = 0;
+        for (; i + Lanes::width <= n; i += Lanes::width)
+        {
+            auto result = Op::lanes(Lanes::load(a + i), Lanes::load(b + i));
+            if (Lanes::has_nan(result))
+            {
+                for (size_t k = i; k < i + Lanes::width; ++k)
+                {
+                    out[k] = Op::scalar(a[k], b[k]);
+                }
+            }
+            else
+            {
+                Lanes::store(out + i, result);
+            }
+        }
+        return i;
+    }
+
+    template <class Op, Rounding mode, class FP>
+    void apply(std::span<const FP> a, std::span<const FP> b, std::span<FP> out)
+    {
+        static_assert(std::is_standard_layout_v<FP> && sizeof(FP) == sizeof(typename FP::storage_type),
+                      "batch kernels read FloatingPoint arrays as their packed encodings");
+        assert(a.size() == out.size() && b.size() == out.size());
+
+        const size_t n = out.size();
+        size_t i = 0;
+        if constexpr (mode == RoundNearestEven && host_lanes<FP>::available &&
+                      requires { Op::lanes(host_lanes<FP>::load(a.data()), host_lanes<FP>::load(b.data())); })
+        {
+            i = run_lanes<Op, host_lanes<FP>>(a.data(), b.data(), out.data(), n);
+        }
+        else if constexpr (mode == RoundNearestEven && requires { Op::block(a.data(), b.data(), out.data(), n); })
+        {
+            i = Op::block(a.data(), b.data(), out.data(), n);
+        }
+
+        // element i takes draw counter + i of the stream
+        StochasticState &state = stochastic_state();
+        const uint64_t counter = state.counter;
+        for (; i < n; ++i)
+        {
+            if constexpr (mode == RoundStochastic)
+                state.counter = counter + i;
+            out[i] = Op::template scalar<FP, mode>(a[i], b[i]);
+        }
+        if constexpr (mode == RoundStochastic)
+            state.counter = counter + n;
+    }
+
+    template <class Op, class Lanes, class FP>
+    size_t run_lanes(const FP *a, FP *out, size_t n)
+    {
+        HostExceptions exceptions;
+        size_t i = 0;
+        for (; i + Lanes::width <= n; i += Lanes::width)
+        {
+            auto result = Op::lanes(Lanes::load(a + i));
+            if (Lanes::has_nan(result))
+            {
+                for (size_t k = i; k < i + Lanes::width; ++k)
+                {
+                    out[k] = Op::scalar(a[k]);
+                }
+            }
+            else
+            {
+                Lanes::store(out + i, result);
+            }
+        }
+        return i;
+    }
+
+    template <class Op, Rounding mode, class FP>
+    void apply(std::span<const FP> a, std::span<FP> out)
+    {
+        static_assert(std::is_standard_layout_v<FP> && sizeof(FP) == sizeof(typename FP::storage_type),
+                      "batch kernels read FloatingPoint arrays as their packed encodings");
+        assert(a.size() == out.size());
+
+        const size_t n = out.size();
+        size_t i = 0;
+        if constexpr (mode == RoundNearestEven && host_lanes<FP>::available &&
+                      requires { Op::lanes(host_lanes<FP>::load(a.data())); })
+        {
+            i = run_lanes<Op, host_lanes<FP>>(a.data(), out.data(), n);
+        }
+        else if constexpr (mode == RoundNearestEven && requires { Op::block(a.data(), out.data(), n); })
+        {
+            i = Op::block(a.data(), out.data(), n);
+        }
+
+        // element i takes draw counter + i of the stream
+        StochasticState &state = stochastic_state();
+        const uint64_t counter = state.counter;
+        for (; i < n; ++i)
+        {
+            if constexpr (mode == RoundStochastic)
+                state.counter = counter + i;
+            out[i] = Op::template scalar<FP, mode>(a[i]);
+        }
+        if constexpr (mode == RoundStochastic)
+            state.counter = counter + n;
+    }
+
+    // Conversion of formats of 8 bits or fewer: one table of the 2^(1 + exponent +
+    // mantissa) converted encodings and the flags each raised, built by the scalar
+    // conversion on first use, so every element costs two loads.
+    template <class Src, class Dst, Rounding mode>
+    struct ConvertTable
+    {
+        std::array<typename Dst::storage_type, 256> encodings;
+        std::array<uint8_t, 256> flags;
+    };
+
+    template <class Src, class Dst, Rounding mode>
+    const ConvertTable<Src, Dst, mode> &convert_table()
+    {
+        static const ConvertTable<Src, Dst, mode> table = []
+        {
+            const unsigned saved = test_flags();
+            ConvertTable<Src, Dst, mode> result{};
+            for (uint64_t code = 0; code < (1ULL << (1 + Src::E_length + Src::M_length)); ++code)
+            {
+                clear_flags();
+                result.encodings[code] = Src(code).template to<Dst, mode>().to_bits();
+                result.flags[code] = static_cast<uint8_t>(test_flags());
+            }
+            clear_flags();
+            raise_flags(saved);
+            return result;
+        }();
+        return table;
+    }
+
+    // Narrowing of an IEEE-layout format to round to nearest even, branch-free on the
+    // encodings so the loop maps onto vector lanes. The significand is rounded at a
+    // per-element position, the mantissa boundary of Dst or below it for results under
+    // Dst's normal range, and the exponent is added back afterwards so that a carry out
+    // of the mantissa bumps it. Covers every Dst inside the source's range, whatever its
+    // traits; flags are kept per lane and merged once at the end.
+    template <class Src, class Dst>
+    constexpr bool narrows_in_lanes = FloatingPointEncoding<Src::E_length, Src::M_length, typename Src::traits_type>::ieee &&
+                                      Dst::M_length < Src::M_length && Dst::E_length <= Src::E_length &&
+                                      Dst::E_bias <= Src::E_bias;
+
+    template <class Src, class Dst>
+    void narrow_lanes(const Src *in, Dst *out, size_t n)
+    {
+        using U = typename Src::storage_type;
+        using D = FloatingPointEncoding<Dst::E_length, Dst::M_length, typename Dst::traits_type>;
+        constexpr int src_mantissa = Src::M_length;
+        constexpr int src_width = Src::E_length + Src::M_length;
+        constexpr int dst_mantissa = Dst::M_length;
+        constexpr int dst_width = Dst::E_length + Dst::M_length;
+        constexpr U magnitude_mask = (U(1) << src_width) - 1;
+        constexpr U infinity = static_cast<U>(Src::E_mask << src_mantissa);
+        // biased exponent of Dst's smallest normal in the source
+        constexpr U E_normal = static_cast<U>(Src::E_bias - Dst::E_bias + 1);
+        constexpr U shift = src_mantissa - dst_mantissa;
+        // magnitudes of overflowed results and infinities, and the NaN of Dst
+        constexpr U dst_overflow = static_cast<U>(D::template overflow<RoundNearestEven>(false));
+        constexpr U dst_infinity = static_cast<U>(D::has_infinity ? D::infinity : dst_overflow);
+        constexpr U dst_nan = static_cast<U>(D::has_infinity ? D::infinity | (1ULL << (dst_mantissa - 1)) : D::quiet_nan);
+
+        auto narrow = [&](U x, U &flags) -> U
+        {
+            const U magnitude = x & magnitude_mask;
+            const U E = magnitude >> src_mantissa;
+            const U sig = (magnitude & static_cast<U>(Src::M_mask)) | (U(E != 0) << src_mantissa);
+
+            // below E_normal every step down in E drops one more bit
+            const U drop = std::min<U>(shift + E_normal - std::min<U>(std::max<U>(E, 1), E_normal), src_mantissa + 2);
+            const U rounded = ((sig + ((U(1) << (drop - 1)) - 1) + ((sig >> drop) & 1)) >> drop) +
+                              ((std::max(E, E_normal) - E_normal) << dst_mantissa);
+
+            // conditions as all-ones or zero masks
+            const U tiny = -U(E < E_normal);
+            const U dropped = -U(static_cast<U>(sig << (sizeof(U) * 8 - drop)) != 0);
+            const U finite = -U(magnitude < infinity);
+            const U nan = -U(magnitude > infinity);
+            const U too_large = finite & -U(rounded > static_cast<U>(D::max_finite));
+            const U payload = D::has_infinity ? (magnitude & static_cast<U>(Src::M_mask)) >> shift : 0;
+            const U result = (finite & ((dst_overflow & too_large) | (rounded & ~too_large))) |
+                             (~finite & (((dst_nan | payload) & nan) | (dst_infinity & ~nan)));
+
+            // a NaN has no sign in a format without NaN
+            const U sign = (x >> (src_width - dst_width)) & (U(1) << dst_width);
+            const U encoding = (D::has_nan ? sign : sign & ~nan) | result;
+
+            const U overflow = too_large | (D::has_infinity ? 0 : finite ^ nan ^ ~U(0));
+            const U invalid = nan & (D::has_nan ? -U(((magnitude >> (src_mantissa - 1)) & 1) == 0) : ~U(0));
+            flags |= (((finite & dropped) | overflow) & FlagInexact) | (finite & tiny & dropped & FlagUnderflow) |
+                     (overflow & FlagOverflow) | (invalid & FlagInvalid);
+            return encoding;
+        };
+
+        // whole blocks are staged at the source width so both loops map onto lanes
+        const U *codes = reinterpret_cast<const U *>(in);
+        typename Dst::storage_type *results = reinterpret_cast<typename Dst::storage_type *>(out);
+        constexpr size_t block = 64;
+        U flags[block] = {};
+        size_t i = 0;
+        for (; i + block <= n; i += block)
+        {
+            U staged[block];
+            for (size_t k = 0; k < block; ++k)
+            {
+                staged[k] = narrow(codes[i + k], flags[k]);
+            }
+            for (size_t k = 0; k < block; ++k)
+            {
+                results[i + k] = static_cast<typename Dst::storage_type>(staged[k]);
+            }
+        }
+        for (; i < n; ++i)
+        {
+            results[i] = static_cast<typename Dst::storage_type>(narrow(codes[i], flags[0]));
+        }
+
+        U raised = 0;
+        for (size_t k = 0; k < block; ++k)
+        {
+            raised |= flags[k];
+        }
+        raise_flags(static_cast<unsigned>(raised));
+    }
+
+    // Widening between Half, Float and Double on the host conversions, which are exact
+    // and quiet a signaling NaN as the scalar conversion does; returns how many
+    // elements were done
+    template <class Src, class Dst>
+    constexpr bool widens_in_lanes = host_lanes<Src>::available && host_lanes<Dst>::available &&
+                                     Dst::M_length > Src::M_length;
+
+    template <class Src, class Dst>
+    size_t widen_lanes(const Src *in, Dst *out, size_t n)
+    {
+        constexpr size_t width = host_lanes<Src>::width;
+        HostExceptions exceptions;
+        size_t i = 0;
+        for (; i + width <= n; i += width)
+        {
+            const auto lanes = host_lanes<Src>::load(in + i);
+            if constexpr (Dst::M_length == 23)
+            {
+                host_lanes<Dst>::store(out + i, lanes);
+            }
+            else
+            {
+#if defined(__AVX512F__)
+                host_lanes<Dst>::store(out + i, _mm512_cvtps_pd(_mm512_castps512_ps256(lanes)));
+                host_lanes<Dst>::store(out + i + 8, _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(lanes), 1))));
+#elif defined(__AVX2__) && defined(__F16C__)
+                host_lanes<Dst>::store(out + i, _mm256_cvtps_pd(_mm256_castps256_ps128(lanes)));
+                host_lanes<Dst>::store(out + i + 4, _mm256_cvtps_pd(_mm256_extractf128_ps(lanes, 1)));
+#endif
+            }
+        }
+        return i;
+    }
+
+    // Widening of the other IEEE-layout formats (BFloat16, 16-bit E5M10 variants, ...)
+    // to Float and Double, branch-free on the encodings: the fields move and the
+    // exponent is rebiased by an add. A subnormal source, normal in a wider exponent
+    // range, is rebuilt as its significand times the weight of its lowest bit on the
+    // host, which is exact and maps onto vector lanes where a leading-one search does
+    // not.
+    template <class Src, class Dst>
+    constexpr bool widens_fields_in_lanes = FloatingPointEncoding<Src::E_length, Src::M_length, typename Src::traits_type>::ieee &&
+                                            (std::is_same_v<Dst, FloatingPoint<8, 23>> || std::is_same_v<Dst, FloatingPoint<11, 52>>) &&
+                                            !widens_in_lanes<Src, Dst> && Dst::M_length > Src::M_length &&
+                                            Dst::E_length >= Src::E_length;
+
+    template <class Src, class Dst>
+    void widen_fields(const Src *in, Dst *out, size_t n)
+    {
+        using U = typename Dst::storage_type;
+        using Host = std::conditional_t<Dst::M_length == 23, float, double>;
+        constexpr int src_mantissa = Src::M_length;
+        constexpr int src_width = Src::E_length + Src::M_length;
+        constexpr int dst_mantissa = Dst::M_length;
+        constexpr int dst_width = Dst::E_length + Dst::M_length;
+        constexpr int shift = dst_mantissa - src_mantissa;
+        constexpr U magnitude_mask = (U(1) << src_width) - 1;
+        constexpr U infinity = static_cast<U>(Src::E_mask << src_mantissa);
+        constexpr U rebias = static_cast<U>(Dst::E_bias - Src::E_bias) << dst_mantissa;
+        constexpr U dst_infinity = static_cast<U>(Dst::E_mask << dst_mantissa);
+        constexpr U quiet = U(1) << (dst_mantissa - 1);
+
+        auto widen = [&](U x, U &flags) -> U
+        {
+            const U magnitude = x & magnitude_mask;
+            const U M = magnitude & static_cast<U>(Src::M_mask);
+            const U sign = (x >> src_width) << dst_width;
+
+            U finite = (magnitude << shift) + rebias;
+            if constexpr (Dst::E_length > Src::E_length)
+            {
+                // 2^(1 - bias - mantissa) of the source, the weight of a subnormal's lowest bit
+                constexpr Host lowest = std::bit_cast<Host>(static_cast<U>(Dst::E_bias + 1 - Src::E_bias - src_mantissa) << dst_mantissa);
+                using Int = std::conditional_t<(src_mantissa < 31), int32_t, int64_t>;
+                const U subnormal = std::bit_cast<U>(static_cast<Host>(static_cast<Int>(M)) * lowest);
+                const U tiny = -U(magnitude < (U(1) << src_mantissa));
+                finite = (subnormal & tiny) | (finite & ~tiny);
+            }
+
+            // conditions as all-ones or zero masks
+            const U is_finite = -U(magnitude < infinity);
+            const U nan = -U(magnitude > infinity);
+            const U special = dst_infinity | (M << shift) | (quiet & nan);
+            flags |= nan & -U((M >> (src_mantissa - 1)) == 0) & FlagInvalid;
+            return sign | (finite & is_finite) | (special & ~is_finite);
+        };
+
+        const typename Src::storage_type *codes = reinterpret_cast<const typename Src::storage_type *>(in);
+        U *results = reinterpret_cast<U *>(out);
+        constexpr size_t block = 64;
+        U flags[block] = {};
+        size_t i = 0;
+        for (; i + block <= n; i += block)
+        {
+            for (size_t k = 0; k < block; ++k)
+            {
+                results[i + k] = widen(codes[i + k], flags[k]);
+            }
+        }
+        for (; i < n; ++i)
+        {
+            results[i] = widen(codes[i], flags[0]);
+        }
+
+        U raised = 0;
+        for (size_t k = 0; k < block; ++k)
+        {
+            raised |= flags[k];
+        }
+        raise_flags(static_cast<unsigned>(raised));
+    }
+
+    // Formats a convert_buffer() pointer stands for: float and double are Float and Double
+    template <class T>
+    struct buffer_format
+    {
+        using type = T;
+    };
+    template <>
+    struct buffer_format<float>
+    {
+        using type = FloatingPoint<8, 23>;
+    };
+    template <>
+    struct buffer_format<double>
+    {
+        using type = FloatingPoint<11, 52>;
+    };
+
+    template <class Op, class Lanes, class FP>
+    size_t run_lanes(const FP *a, const FP *b, const FP *c, FP *out, size_t n)
+    {
+        HostExceptions exceptions;
+        size_t i = 0;
+        for (; i + Lanes::width <= n; i += Lanes::width)
+        {
+            auto result = Op::lanes(Lanes::load(a + i), Lanes::load(b + i), Lanes::load(c + i));
+            if (Lanes::has_nan(result))
+            {
+                for (size_t k = i; k < i + Lanes::width; ++k)
+                {
+                    out[k] = Op::scalar(a[k], b[k], c[k]);
+                }
+                continue;
+            }
+            // the scalar results are taken before the store, which may overwrite a, b or c
+            unsigned redo = Lanes::rounds_twice(result);
+            FP redone[Lanes::width];
+            for (unsigned lanes = redo; lanes != 0; lanes &= lanes - 1)
+            {
+                const size_t k = i + std::countr_zero(lanes);
+                redone[k - i] = Op::scalar(a[k], b[k], c[k]);
+            }
+            Lanes::store(out + i, result);
+            for (; redo != 0; redo &= redo - 1)
+            {
+                const size_t k = std::countr_zero(redo);
+                out[i + k] = redone[k];
+            }
+        }
+        return i;
+    }
+
+    template <class Op, Rounding mode, class FP>
+    void apply(std::span<const FP> a, std::span<const FP> b, std::span<const FP> c, std::span<FP> out)
+    {
+        static_assert(std::is_standard_layout_v<FP> && sizeof(FP) == sizeof(typename FP::storage_type),
+                      "batch kernels read FloatingPoint arrays as their packed encodings");
+        assert(a.size() == out.size() && b.size() == out.size() && c.size() == out.size());
+
+        const size_t n = out.size();
+        size_t i = 0;
+        if constexpr (mode == RoundNearestEven && host_lanes<FP>::available &&
+                      requires { Op::lanes(host_lanes<FP>::load(a.data()), host_lanes<FP>::load(b.data()),
+                                           host_lanes<FP>::load(c.data())); })
+        {
+            i = run_lanes<Op, host_lanes<FP>>(a.data(), b.data(), c.data(), out.data(), n);
+        }
+
+        // element i takes draw counter + i of the stream
+        StochasticState &state = stochastic_state();
+        const uint64_t counter = state.counter;
+        for (; i < n; ++i)
+        {
+            if constexpr (mode == RoundStochastic)
+                state.counter = counter + i;
+            out[i] = Op::template scalar<FP, mode>(a[i], b[i], c[i]);
+        }
+        if constexpr (mode == RoundStochastic)
+            state.counter = counter + n;
+    }
+
+    // Elements a convert_buffer() thread takes at a time
+    inline constexpr size_t buffer_chunk = size_t(1) << 16;
+}
+
+// out[i] = a[i] + b[i]; out may alias a or b
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void add(std::span<const FloatingPoint<exponent, mantissa, Traits>> a,
+         std::span<const FloatingPoint<exponent, mantissa, Traits>> b,
+         std::span<FloatingPoint<exponent, mantissa, Traits>> out)
+{
+    batch_detail::apply<batch_detail::Add, mode>(a, b, out);
+}
+
+// out[i] = a[i] * b[i]; out may alias a or b
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void mul(std::span<const FloatingPoint<exponent, mantissa, Traits>> a,
+         std::span<const FloatingPoint<exponent, mantissa, Traits>> b,
+         std::span<FloatingPoint<exponent, mantissa, Traits>> out)
+{
+    batch_detail::apply<batch_detail::Mul, mode>(a, b, out);
+}
+
+// out[i] = fma(a[i], b[i], c[i]), rounded once; out may alias a, b or c
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void fma(std::span<const FloatingPoint<exponent, mantissa, Traits>> a,
+         std::span<const FloatingPoint<exponent, mantissa, Traits>> b,
+         std::span<const FloatingPoint<exponent, mantissa, Traits>> c,
+         std::span<FloatingPoint<exponent, mantissa, Traits>> out)
+{
+    batch_detail::apply<batch_detail::Fma, mode>(a, b, c, out);
+}
+
+// out[i] = a[i] / b[i]; out may alias a or b
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void div(std::span<const FloatingPoint<exponent, mantissa, Traits>> a,
+         std::span<const FloatingPoint<exponent, mantissa, Traits>> b,
+         std::span<FloatingPoint<exponent, mantissa, Traits>> out)
+{
+    batch_detail::apply<batch_detail::Div, mode>(a, b, out);
+}
+
+// out[i] = 1 / a[i]; out may alias a
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void reciprocal(std::span<const FloatingPoint<exponent, mantissa, Traits>> a,
+                std::span<FloatingPoint<exponent, mantissa, Traits>> out)
+{
+    batch_detail::apply<batch_detail::Reciprocal, mode>(a, out);
+}
+
+// out[i] = sqrt(a[i]); out may alias a
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void sqrt(std::span<const FloatingPoint<exponent, mantissa, Traits>> a,
+          std::span<FloatingPoint<exponent, mantissa, Traits>> out)
+{
+    batch_detail::apply<batch_detail::Sqrt, mode>(a, out);
+}
+
+// out[i] = exp(a[i]); out may alias a
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void exp(std::span<const FloatingPoint<exponent, mantissa, Traits>> a,
+         std::span<FloatingPoint<exponent, mantissa, Traits>> out)
+{
+    batch_detail::apply<batch_detail::Exp, mode>(a, out);
+}
+
+// out[i] = exp2(a[i]); out may alias a
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void exp2(std::span<const FloatingPoint<exponent, mantissa, Traits>> a,
+          std::span<FloatingPoint<exponent, mantissa, Traits>> out)
+{
+    batch_detail::apply<batch_detail::Exp2, mode>(a, out);
+}
+
+// out[i] = log(a[i]); out may alias a
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void log(std::span<const FloatingPoint<exponent, mantissa, Traits>> a,
+         std::span<FloatingPoint<exponent, mantissa, Traits>> out)
+{
+    batch_detail::apply<batch_detail::Log, mode>(a, out);
+}
+
+// out[i] = log2(a[i]); out may alias a
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void log2(std::span<const FloatingPoint<exponent, mantissa, Traits>> a,
+          std::span<FloatingPoint<exponent, mantissa, Traits>> out)
+{
+    batch_detail::apply<batch_detail::Log2, mode>(a, out);
+}
+
+// out[i] = pow(a[i], b[i]); out may alias a or b
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void pow(std::span<const FloatingPoint<exponent, mantissa, Traits>> a,
+         std::span<const FloatingPoint<exponent, mantissa, Traits>> b,
+         std::span<FloatingPoint<exponent, mantissa, Traits>> out)
+{
+    batch_detail::apply<batch_detail::Pow, mode>(a, b, out);
+}
+
+// out[i] = in[i] rounded into the format of out. Sources of 8 bits or fewer (FP8 and
+// smaller) read a table; IEEE-layout sources narrowing under RoundNearestEven to a
+// format inside their range (Float to E4M3, E5M2, BFloat16 or Half, ...) run a
+// branch-free loop over the encodings; Half, Float and Double widen on the host
+// lanes and other IEEE-layout sources widen to Float and Double in a branch-free
+// loop; every other pair converts element by element.
+template <Rounding mode = RoundNearestEven, int SrcE, int SrcM, class SrcTraits, int DstE, int DstM, class DstTraits>
+void convert(std::span<const FloatingPoint<SrcE, SrcM, SrcTraits>> in,
+             std::span<FloatingPoint<DstE, DstM, DstTraits>> out)
+{
+    using Src = FloatingPoint<SrcE, SrcM, SrcTraits>;
+    using Dst = FloatingPoint<DstE, DstM, DstTraits>;
+    static_assert(std::is_standard_layout_v<Src> && sizeof(Src) == sizeof(typename Src::storage_type) &&
+                      std::is_standard_layout_v<Dst> && sizeof(Dst) == sizeof(typename Dst::storage_type),
+                  "batch kernels read FloatingPoint arrays as their packed encodings");
+    assert(in.size() == out.size());
+
+    const size_t n = out.size();
+    if constexpr (mode != RoundStochastic && 1 + SrcE + SrcM <= 8)
+    {
+        const auto &table = batch_detail::convert_table<Src, Dst, mode>();
+        const uint8_t *codes = reinterpret_cast<const uint8_t *>(in.data());
+        typename Dst::storage_type *results = reinterpret_cast<typename Dst::storage_type *>(out.data());
+        unsigned flags = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            results[i] = table.encodings[codes[i]];
+            flags |= table.flags[codes[i]];
+        }
+        raise_flags(flags);
+    }
+    else if constexpr (mode == RoundNearestEven && batch_detail::narrows_in_lanes<Src, Dst>)
+    {
+        batch_detail::narrow_lanes(in.data(), out.data(), n);
+    }
+    else
+    {
+        size_t i = 0;
+        if constexpr (batch_detail::widens_in_lanes<Src, Dst>)
+        {
+            i = batch_detail::widen_lanes(in.data(), out.data(), n);
+        }
+        else if constexpr (batch_detail::widens_fields_in_lanes<Src, Dst>)
+        {
+            batch_detail::widen_fields(in.data(), out.data(), n);
+            i = n;
+        }
+        // element i takes draw counter + i of the stream
+        StochasticState &state = stochastic_state();
+        const uint64_t counter = state.counter;
+        for (; i < n; ++i)
+        {
+            if constexpr (mode == RoundStochastic)
+                state.counter = counter + i;
+            out[i] = in[i].template to<Dst, mode>();
+        }
+        if constexpr (mode == RoundStochastic)
+            state.counter = counter + n;
+    }
+}
+
+namespace batch_detail
+{
+    // convert() over buffers that may really hold float or double, read and written as
+    // their Float and Double encodings. Nothing tells the compiler those accesses touch
+    // the caller's float and double objects, so a compiler fence on either side keeps
+    // the caller's own accesses from moving across the conversion.
+    template <Rounding mode, class SrcT, class DstT>
+    void convert_host(const SrcT *in, size_t n, DstT *out)
+    {
+        using Src = typename buffer_format<SrcT>::type;
+        using Dst = typename buffer_format<DstT>::type;
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+        convert<mode>(std::span<const Src>(reinterpret_cast<const Src *>(in), n),
+                      std::span<Dst>(reinterpret_cast<Dst *>(out), n));
+        std::atomic_signal_fence(std::memory_order_seq_cst);
+    }
+}
+
+// out[i] = in[i] for i < n between any two formats, with float and double standing for
+// Float and Double, e.g. convert_buffer(floats, n, halves). The buffer is cut into
+// chunks shared out between threads (0 takes std::thread::hardware_concurrency()),
+// each converted by convert(). out may be the same buffer as in when its elements are
+// no wider: the chunks then go in waves, each thread converting its chunk into a
+// buffer of its own before any chunk of the wave is written back; otherwise in and
+// out must not overlap. The flags raised on every thread reach the caller, and under
+// RoundStochastic element i takes draw counter + i of the caller's stream, so the
+// result does not depend on the number of threads.
+template <Rounding mode = RoundNearestEven, class SrcT, class DstT>
+void convert_buffer(const SrcT *in, size_t n, DstT *out, unsigned threads = 0)
+{
+    using Src = typename batch_detail::buffer_format<SrcT>::type;
+    using Dst = typename batch_detail::buffer_format<DstT>::type;
+    static_assert(sizeof(Src) == sizeof(SrcT) && sizeof(Dst) == sizeof(DstT),
+                  "convert_buffer() reads float and double buffers as Float and Double");
+    const bool in_place = static_cast<const void *>(in) == static_cast<const void *>(out);
+    assert(!in_place || sizeof(Dst) <= sizeof(Src));
+    assert(in_place || reinterpret_cast<const char *>(in) + n * sizeof(Src) <= reinterpret_cast<const char *>(out) ||
+           reinterpret_cast<const char *>(out) + n * sizeof(Dst) <= reinterpret_cast<const char *>(in));
+
+    constexpr size_t chunk = batch_detail::buffer_chunk;
+    const size_t chunks = (n + chunk - 1) / chunk;
+    threads = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, chunks)));
+
+    StochasticState &caller = stochastic_state();
+    const StochasticState start = caller;
+    std::atomic<unsigned> raised{0};
+
+    auto convert_chunk = [&](size_t c, DstT *to)
+    {
+        const size_t begin = c * chunk;
+        const size_t length = std::min(chunk, n - begin);
+        if constexpr (mode == RoundStochastic)
+        {
+            StochasticState &state = stochastic_state();
+            state.key = start.key;
+            state.counter = start.counter + begin;
+        }
+        batch_detail::convert_host<mode>(in + begin, length, to);
+    };
+
+    std::barrier wave(threads);
+    std::atomic<size_t> next{0};
+    auto worker = [&](unsigned t)
+    {
+        if (in_place)
+        {
+            // a wave writes below the first element of the next, so one barrier a wave
+            // keeps every write behind the reads it overlaps
+            std::vector<DstT> staged(std::min(chunk, n));
+            for (size_t first = 0; first < chunks; first += threads)
+            {
+                const size_t c = first + t;
+                if (c < chunks)
+                    convert_chunk(c, staged.data());
+                wave.arrive_and_wait();
+                if (c < chunks)
+                    std::memcpy(static_cast<void *>(out + c * chunk), staged.data(), std::min(chunk, n - c * chunk) * sizeof(DstT));
+            }
+        }
+        else
+        {
+            for (size_t c = next++; c < chunks; c = next++)
+            {
+                convert_chunk(c, out + c * chunk);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t)
+    {
+        pool.emplace_back([&, t]
+                          {
+            worker(t);
+            raised |= test_flags(); });
+    }
+    worker(0);
+    for (std::thread &thread : pool)
+    {
+        thread.join();
+    }
+    raise_flags(raised);
+
+    if constexpr (mode == RoundStochastic)
+    {
+        caller.key = start.key;
+        caller.counter = start.counter + n;
+    }
+}
+
+// out[i] = in[i] as a host float or double, by convert() to Float or Double
+template <int exponent, int mantissa, class Traits>
+void to_float(std::span<const FloatingPoint<exponent, mantissa, Traits>> in, std::span<float> out)
+{
+    assert(in.size() == out.size());
+    batch_detail::convert_host<RoundNearestEven>(in.data(), in.size(), out.data());
+}
+
+template <int exponent, int mantissa, class Traits>
+void to_double(std::span<const FloatingPoint<exponent, mantissa, Traits>> in, std::span<double> out)
+{
+    assert(in.size() == out.size());
+    batch_detail::convert_host<RoundNearestEven>(in.data(), in.size(), out.data());
+}
+
+// acc = fma(a[i], b[i], acc) for i = 0, 1, ..., one rounding per step. A finite non-zero
+// accumulator stays unpacked as sign, exponent and significand between steps; it is only
+// packed when a step leaves that range or meets a special operand.
+template <int exponent, int mantissa, class Traits>
+void fma_accumulate(std::span<const FloatingPoint<exponent, mantissa, Traits>> a,
+                    std::span<const FloatingPoint<exponent, mantissa, Traits>> b,
+                    FloatingPoint<exponent, mantissa, Traits> &acc)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    using Encoding = FloatingPointEncoding<exponent, mantissa, Traits>;
+    assert(a.size() == b.size());
+
+    auto finite_non_zero = [](State state)
+    { return state == Normal || state == Subnormal; };
+
+    bool acc_sign = acc.get_sign();
+    int64_t acc_exp = 0;
+    uint64_t acc_mantissa = 0;
+    bool unpacked = finite_non_zero(acc.get_state());
+    if (unpacked)
+    {
+        acc_mantissa = acc.unpack(acc_exp);
+    }
+
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (unpacked && finite_non_zero(a[i].get_state()) && finite_non_zero(b[i].get_state()))
+        {
+            int64_t exp1, exp2;
+            uint64_t mantissa1 = a[i].unpack(exp1);
+            uint64_t mantissa2 = b[i].unpack(exp2);
+            uint64_t high;
+            uint64_t low = multiply_wide(mantissa1, mantissa2, high);
+
+            bool sign;
+            int64_t exp;
+            bool sticky = false;
+            uint64_t sum = fused_sum(sign, exp, sticky,
+                                     a[i].get_sign() ^ b[i].get_sign(), exp1 + exp2,
+                                     (static_cast<unsigned __int128>(high) << 64) | low,
+                                     acc_sign, acc_exp, acc_mantissa);
+            if (sum != 0)
+            {
+                int64_t rounded_exp = exp;
+                uint64_t rounded = round_significand<exponent, mantissa, RoundNearestEven, Traits>(sign, rounded_exp, sum, sticky);
+                // the encoding it packs to, as in round_pack(), must be finite
+                const uint64_t magnitude = (static_cast<uint64_t>(rounded_exp + mantissa + Encoding::bias - 1) << mantissa) + rounded;
+                if (rounded != 0 && magnitude <= Encoding::max_finite)
+                {
+                    acc_sign = sign;
+                    acc_exp = rounded_exp;
+                    acc_mantissa = rounded;
+                    continue;
+                }
+            }
+
+            // cancelled, overflowed or underflowed to zero
+            acc = (sum == 0) ? FP::createZero() : FP(round_pack<exponent, mantissa, RoundNearestEven, Traits>(sign, exp, sum, sticky));
+            unpacked = false;
+            continue;
+        }
+
+        if (unpacked)
+        {
+            acc = FP(round_pack<exponent, mantissa, RoundNearestEven, Traits>(acc_sign, acc_exp, acc_mantissa));
+        }
+        acc = a[i].fma(b[i], acc);
+        acc_sign = acc.get_sign();
+        unpacked = finite_non_zero(acc.get_state());
+        if (unpacked)
+        {
+            acc_mantissa = acc.unpack(acc_exp);
+        }
+    }
+
+    if (unpacked)
+    {
+        acc = FP(round_pack<exponent, mantissa, RoundNearestEven, Traits>(acc_sign, acc_exp, acc_mantissa));
+    }
+}
+
+#endif // BATCH_HPP_
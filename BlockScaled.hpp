@@ -0,0 +1,396 @@
+#ifndef BLOCKSCALED_HPP_
+#define BLOCKSCALED_HPP_
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <vector>
+#include "Batch.hpp"
+
+// Block-scaled arrays in the layout of the OCP Microscaling (MX) formats: every block of
+// BlockSize elements shares one E8M0 scale, a power of two 2^(code - 127) stored in a
+// byte, and each element keeps only its 1 + ElemE + ElemM bits, packed back to back
+// with element 0 in the low bits of the first byte. An MXFP4 array of n values
+// therefore takes n / 2 + n / 32 bytes.
+//
+// Quantizing a block takes the shared exponent floor(log2(max |v|)) minus the exponent
+// of the element format's largest normal, clamped to the E8M0 range, and rounds each
+// v / 2^shared to the element format to nearest even; elements saturate, so the block
+// maximum may clamp to the largest finite element. A block holding an infinity or NaN
+// gets the NaN scale (code 255) and reads back as NaN throughout. Element rounding
+// raises the flags of the element conversion.
+//
+// Dequantizing multiplies each element by its block's scale in the host format, so it
+// is rounded once into Float or Double. dot() and add() work block by block on the
+// element values: dot sums the exact element products of a block pair in double and
+// scales the sum by both shared exponents; add adds the dequantized blocks in double
+// and quantizes the sum back, choosing a new shared exponent for each block.
+
+namespace block_detail
+{
+    // Element traits of the MX formats: E5M2 keeps IEEE infinity and NaN and E4M3 only
+    // NaN, FP6 and FP4 have neither; conversions into all of them saturate
+    template <int exponent, int mantissa>
+    struct mx_traits
+    {
+        using type = FloatingPointTraits<0, SpecialsNone>;
+    };
+    template <>
+    struct mx_traits<5, 2>
+    {
+        using type = FloatingPointTraits<0, SpecialsIEEE, true>;
+    };
+    template <>
+    struct mx_traits<4, 3>
+    {
+        using type = FloatingPointTraits<0, SpecialsNanOnly, true>;
+    };
+
+    // Host type holding the values of a wide format
+    template <class Wide>
+    struct host_type;
+    template <>
+    struct host_type<FloatingPoint<8, 23>>
+    {
+        using type = float;
+    };
+    template <>
+    struct host_type<FloatingPoint<11, 52>>
+    {
+        using type = double;
+    };
+
+    inline constexpr uint8_t scale_nan = 0xFF;
+    inline constexpr int scale_bias = 127;
+
+    // Pack count codes of bits bits each into bytes, element 0 in the low bits
+    template <int bits>
+    void pack(const uint8_t *codes, size_t count, uint8_t *bytes)
+    {
+        if constexpr (bits == 8)
+        {
+            std::memcpy(bytes, codes, count);
+        }
+        else
+        {
+            uint32_t buffer = 0;
+            int filled = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                buffer |= static_cast<uint32_t>(codes[i]) << filled;
+                filled += bits;
+                while (filled >= 8)
+                {
+                    *bytes++ = static_cast<uint8_t>(buffer);
+                    buffer >>= 8;
+                    filled -= 8;
+                }
+            }
+            if (filled > 0)
+            {
+                *bytes = static_cast<uint8_t>(buffer);
+            }
+        }
+    }
+
+    template <int bits>
+    void unpack(const uint8_t *bytes, size_t count, uint8_t *codes)
+    {
+        if constexpr (bits == 8)
+        {
+            std::memcpy(codes, bytes, count);
+        }
+        else
+        {
+            constexpr uint32_t mask = (1u << bits) - 1;
+            uint32_t buffer = 0;
+            int filled = 0;
+            for (size_t i = 0; i < count; ++i)
+            {
+                if (filled < bits)
+                {
+                    buffer |= static_cast<uint32_t>(*bytes++) << filled;
+                    filled += 8;
+                }
+                codes[i] = static_cast<uint8_t>(buffer & mask);
+                buffer >>= bits;
+                filled -= bits;
+            }
+        }
+    }
+
+    // Value of every encoding of Elem in Host, built once
+    template <class Elem, class Host>
+    const std::array<Host, 256> &element_values()
+    {
+        using Wide = std::conditional_t<std::is_same_v<Host, float>, FloatingPoint<8, 23>, FloatingPoint<11, 52>>;
+        static const std::array<Host, 256> table = []
+        {
+            std::array<Host, 256> result{};
+            for (uint64_t code = 0; code < (1ULL << (1 + Elem::E_length + Elem::M_length)); ++code)
+            {
+                // widening is exact and raises nothing
+                result[code] = std::bit_cast<Host>(Elem(code).template to<Wide>().to_bits());
+            }
+            return result;
+        }();
+        return table;
+    }
+}
+
+template <int ElemE, int ElemM, size_t BlockSize = 32, class ElemTraits = typename block_detail::mx_traits<ElemE, ElemM>::type>
+class BlockScaled
+{
+    static_assert(1 + ElemE + ElemM <= 8, "block-scaled elements are formats of 8 bits or fewer");
+    static_assert(BlockSize > 0, "blocks hold at least one element");
+
+public:
+    using element_type = FloatingPoint<ElemE, ElemM, ElemTraits>;
+    static constexpr int element_bits = 1 + ElemE + ElemM;
+    static constexpr size_t block_size = BlockSize;
+    static constexpr size_t block_bytes = (BlockSize * element_bits + 7) / 8;
+
+    BlockScaled() = default;
+
+    // size zeros
+    explicit BlockScaled(size_t size)
+        : count(size), scales(block_count(size), 0), elements(block_count(size) * block_bytes, 0) {}
+
+    explicit BlockScaled(std::span<const FloatingPoint<8, 23>> values) : BlockScaled(values.size()) { quantize(values); }
+    explicit BlockScaled(std::span<const FloatingPoint<11, 52>> values) : BlockScaled(values.size()) { quantize(values); }
+
+    size_t size() const { return count; }
+    size_t blocks() const { return scales.size(); }
+    // storage of the scales and packed elements
+    size_t bytes() const { return scales.size() + elements.size(); }
+
+    // E8M0 code of the scale of a block, 2^(code - 127); 255 is NaN
+    uint8_t scale(size_t block) const { return scales[block]; }
+    // block_bytes bytes of packed elements of a block
+    const uint8_t *block_data(size_t block) const { return elements.data() + block * block_bytes; }
+
+    // Element i as stored, before scaling
+    element_type element(size_t i) const
+    {
+        std::array<uint8_t, BlockSize> codes;
+        block_detail::unpack<element_bits>(block_data(i / BlockSize), BlockSize, codes.data());
+        return element_type(static_cast<uint64_t>(codes[i % BlockSize]));
+    }
+
+    // values.size() must be size()
+    void quantize(std::span<const FloatingPoint<8, 23>> values) { quantize_from(values); }
+    void quantize(std::span<const FloatingPoint<11, 52>> values) { quantize_from(values); }
+
+    // out.size() must be size()
+    void dequantize(std::span<FloatingPoint<8, 23>> out) const { dequantize_to(out); }
+    void dequantize(std::span<FloatingPoint<11, 52>> out) const { dequantize_to(out); }
+
+private:
+    template <int E, int M, size_t B, class T>
+    friend void add(const BlockScaled<E, M, B, T> &, const BlockScaled<E, M, B, T> &, BlockScaled<E, M, B, T> &);
+
+    using Encoding = FloatingPointEncoding<ElemE, ElemM, ElemTraits>;
+
+    static size_t block_count(size_t size) { return (size + BlockSize - 1) / BlockSize; }
+    size_t block_length(size_t block) const { return std::min(BlockSize, count - block * BlockSize); }
+    uint8_t *block_data(size_t block) { return elements.data() + block * block_bytes; }
+
+    // Shared scale code of a block whose largest magnitude is max
+    template <class Host>
+    static uint8_t choose_scale(Host max, bool finite)
+    {
+        if (!finite)
+        {
+            return block_detail::scale_nan;
+        }
+        if (max == 0)
+        {
+            return 0;
+        }
+        const int shared = std::clamp(std::ilogb(max) - static_cast<int>(Encoding::E_max),
+                                      -block_detail::scale_bias, block_detail::scale_bias);
+        return static_cast<uint8_t>(shared + block_detail::scale_bias);
+    }
+
+    // Quantize the host values of blocks [first, first + n): stage v / 2^shared for a
+    // run of blocks, then convert the run at once so the narrowing fills vector lanes
+    template <class Host>
+    void quantize_blocks(const Host *values, size_t first, size_t n)
+    {
+        using Wide = std::conditional_t<std::is_same_v<Host, float>, FloatingPoint<8, 23>, FloatingPoint<11, 52>>;
+        constexpr size_t run = std::max<size_t>(1, 256 / BlockSize);
+        std::array<Host, run * BlockSize> staged;
+        std::array<Wide, run * BlockSize> wide;
+        std::array<element_type, run * BlockSize> rounded;
+
+        for (size_t r0 = 0; r0 < n; r0 += run)
+        {
+            const size_t blocks_in_run = std::min(run, n - r0);
+            for (size_t k = 0; k < blocks_in_run; ++k)
+            {
+                const size_t block = first + r0 + k;
+                const size_t length = block_length(block);
+                const Host *in = values + (r0 + k) * BlockSize;
+
+                Host max = 0;
+                bool finite = true;
+                for (size_t i = 0; i < length; ++i)
+                {
+                    const Host magnitude = std::fabs(in[i]);
+                    max = magnitude > max ? magnitude : max;
+                    finite &= magnitude <= std::numeric_limits<Host>::max();
+                }
+                scales[block] = choose_scale(max, finite);
+
+                // a power of two: the staged values are exact
+                const Host factor = scales[block] == block_detail::scale_nan
+                                        ? Host(0)
+                                        : std::ldexp(Host(1), block_detail::scale_bias - scales[block]);
+                Host *out = staged.data() + k * BlockSize;
+                for (size_t i = 0; i < length; ++i)
+                {
+                    out[i] = in[i] * factor;
+                }
+                std::fill(out + length, out + BlockSize, Host(0));
+            }
+
+            const size_t staged_count = blocks_in_run * BlockSize;
+            std::memcpy(static_cast<void *>(wide.data()), staged.data(), staged_count * sizeof(Host));
+            convert(std::span<const Wide>(wide.data(), staged_count), std::span<element_type>(rounded.data(), staged_count));
+
+            for (size_t k = 0; k < blocks_in_run; ++k)
+            {
+                std::array<uint8_t, BlockSize> codes;
+                std::memcpy(codes.data(), rounded.data() + k * BlockSize, BlockSize);
+                block_detail::pack<element_bits>(codes.data(), BlockSize, block_data(first + r0 + k));
+            }
+        }
+    }
+
+    template <class Wide>
+    void quantize_from(std::span<const Wide> values)
+    {
+        using Host = typename block_detail::host_type<Wide>::type;
+        static_assert(sizeof(Wide) == sizeof(Host), "Float and Double are stored as the host formats");
+        assert(values.size() == count);
+
+        // a trailing partial block is padded with zeros
+        std::array<Host, BlockSize> tail{};
+        const size_t whole = count / BlockSize;
+        quantize_blocks(reinterpret_cast<const Host *>(values.data()), 0, whole);
+        if (whole < blocks())
+        {
+            std::memcpy(tail.data(), values.data() + whole * BlockSize, (count - whole * BlockSize) * sizeof(Host));
+            quantize_blocks(tail.data(), whole, 1);
+        }
+    }
+
+    // Values of block as Host, scaled
+    template <class Host>
+    void dequantize_block(size_t block, Host *out) const
+    {
+        const std::array<Host, 256> &values = block_detail::element_values<element_type, Host>();
+        std::array<uint8_t, BlockSize> codes;
+        block_detail::unpack<element_bits>(block_data(block), BlockSize, codes.data());
+        if (scales[block] == block_detail::scale_nan)
+        {
+            std::fill(out, out + BlockSize, std::numeric_limits<Host>::quiet_NaN());
+            return;
+        }
+        const Host factor = std::ldexp(Host(1), scales[block] - block_detail::scale_bias);
+        for (size_t i = 0; i < BlockSize; ++i)
+        {
+            out[i] = values[codes[i]] * factor;
+        }
+    }
+
+    template <class Wide>
+    void dequantize_to(std::span<Wide> out) const
+    {
+        using Host = typename block_detail::host_type<Wide>::type;
+        assert(out.size() == count);
+
+        // the scaling is the one rounding; the host reports its overflow and underflow
+        batch_detail::HostExceptions exceptions;
+        std::array<Host, BlockSize> block_values;
+        for (size_t block = 0; block < blocks(); ++block)
+        {
+            dequantize_block(block, block_values.data());
+            std::memcpy(static_cast<void *>(out.data() + block * BlockSize), block_values.data(), block_length(block) * sizeof(Host));
+        }
+    }
+
+    size_t count = 0;
+    std::vector<uint8_t> scales;
+    std::vector<uint8_t> elements;
+};
+
+// OCP MX formats: blocks of 32 elements with an E8M0 scale
+using MXFP8_E5M2 = BlockScaled<5, 2>;
+using MXFP8_E4M3 = BlockScaled<4, 3>;
+using MXFP6_E3M2 = BlockScaled<3, 2>;
+using MXFP6_E2M3 = BlockScaled<2, 3>;
+using MXFP4 = BlockScaled<2, 1>;
+
+// Sum of a[i] * b[i] rounded to Float; the element formats may differ
+template <int AE, int AM, class AT, int BE, int BM, class BT, size_t BlockSize>
+FloatingPoint<8, 23> dot(const BlockScaled<AE, AM, BlockSize, AT> &a, const BlockScaled<BE, BM, BlockSize, BT> &b)
+{
+    using A = BlockScaled<AE, AM, BlockSize, AT>;
+    using B = BlockScaled<BE, BM, BlockSize, BT>;
+    assert(a.size() == b.size());
+
+    const std::array<double, 256> &a_values = block_detail::element_values<typename A::element_type, double>();
+    const std::array<double, 256> &b_values = block_detail::element_values<typename B::element_type, double>();
+    std::array<uint8_t, BlockSize> a_codes, b_codes;
+    double total = 0;
+    for (size_t block = 0; block < a.blocks(); ++block)
+    {
+        if (a.scale(block) == block_detail::scale_nan || b.scale(block) == block_detail::scale_nan)
+        {
+            return FloatingPoint<8, 23>(std::numeric_limits<double>::quiet_NaN());
+        }
+        // padding elements are zero, so whole blocks can be summed
+        block_detail::unpack<A::element_bits>(a.block_data(block), BlockSize, a_codes.data());
+        block_detail::unpack<B::element_bits>(b.block_data(block), BlockSize, b_codes.data());
+        double sum = 0;
+        for (size_t i = 0; i < BlockSize; ++i)
+        {
+            sum += a_values[a_codes[i]] * b_values[b_codes[i]];
+        }
+        total += std::ldexp(sum, a.scale(block) + b.scale(block) - 2 * block_detail::scale_bias);
+    }
+    return FloatingPoint<8, 23>(total);
+}
+
+// out = a + b, requantized block by block; out may alias a or b
+template <int ElemE, int ElemM, size_t BlockSize, class ElemTraits>
+void add(const BlockScaled<ElemE, ElemM, BlockSize, ElemTraits> &a,
+         const BlockScaled<ElemE, ElemM, BlockSize, ElemTraits> &b,
+         BlockScaled<ElemE, ElemM, BlockSize, ElemTraits> &out)
+{
+    assert(a.size() == b.size() && a.size() == out.size());
+
+    std::array<double, BlockSize> a_values, b_values;
+    for (size_t block = 0; block < a.blocks(); ++block)
+    {
+        a.dequantize_block(block, a_values.data());
+        b.dequantize_block(block, b_values.data());
+        for (size_t i = 0; i < BlockSize; ++i)
+        {
+            a_values[i] += b_values[i];
+        }
+        // keep the padding of a trailing block zero
+        std::fill(a_values.begin() + out.block_length(block), a_values.end(), 0.0);
+        out.quantize_blocks(a_values.data(), block, 1);
+    }
+}
+
+#endif // BLOCKSCALED_HPP_
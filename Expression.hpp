@@ -0,0 +1,434 @@
+#ifndef EXPRESSION_HPP_
+#define EXPRESSION_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <vector>
+#include "Batch.hpp"
+
+// Lazy element-wise expressions over arrays of one format. lazy(x) wraps an array, and
+// +, -, *, /, unary -, sqrt() and fma() on wrapped arrays and single values build the
+// expression tree without computing anything:
+//
+//     evaluate(a * lazy(x) + lazy(y), std::span<Half>(y)); // y = a * x + y
+//
+// evaluate() walks the output 2048 elements at a time and runs the whole tree on each
+// block through the batch kernels, so intermediate results live in block-sized
+// buffers that stay in cache and the arrays are read and written in a single pass.
+// The output may alias any array of the expression element for element, but not with
+// an offset.
+//
+// Under ContractOff every operation rounds on its own and the result is bit-identical
+// to applying the operators element by element. ContractFma fuses a product feeding an
+// addition or subtraction, a * b + c, a * b - c and c - a * b, into one fma() with a
+// single rounding; like a compiler's floating-point contraction it changes results in
+// the last bit, so it has to be asked for. Rounding modes other than the default run
+// the scalar routines, and under RoundStochastic every operation of the tree is a batch
+// call over a block (see Batch.hpp), so the draws depend on the seed, the expression
+// and the element positions only.
+
+enum Contraction
+{
+    ContractOff,
+    ContractFma
+};
+
+namespace expr_detail
+{
+    inline constexpr size_t block = 2048;
+    inline constexpr size_t any_size = std::numeric_limits<size_t>::max();
+
+    // Operations of the tree besides the kernels of batch_detail: a - b runs as a + (-b),
+    // exactly as sub() does, and negation flips the sign bits
+    struct Sub
+    {
+    };
+    struct Neg
+    {
+    };
+
+    // Encodings are moved in runs of a fixed length, which the vectoriser takes at -O2
+    // where it leaves loops of a variable count alone
+    inline constexpr size_t run = 32;
+
+    // out[i] = -in[i] on the encodings; out may alias in
+    template <class FP>
+    void negate(const FP *in, FP *out, size_t n)
+    {
+        using storage_type = typename FP::storage_type;
+        constexpr storage_type sign_bit = static_cast<storage_type>(uint64_t(1) << (FP::E_length + FP::M_length));
+        const storage_type *codes = reinterpret_cast<const storage_type *>(in);
+        storage_type *result = reinterpret_cast<storage_type *>(out);
+        size_t i = 0;
+        for (; i + run <= n; i += run)
+        {
+            storage_type flipped[run];
+            for (size_t k = 0; k < run; ++k)
+            {
+                flipped[k] = codes[i + k] ^ sign_bit;
+            }
+            std::copy(flipped, flipped + run, result + i);
+        }
+        for (; i < n; ++i)
+        {
+            result[i] = codes[i] ^ sign_bit;
+        }
+    }
+
+    // out[0, n) = value on the encodings
+    template <class FP>
+    void fill(FP *out, size_t n, FP value)
+    {
+        using storage_type = typename FP::storage_type;
+        storage_type *result = reinterpret_cast<storage_type *>(out);
+        const storage_type code = value.to_bits();
+        size_t i = 0;
+        for (; i + run <= n; i += run)
+        {
+            for (size_t k = 0; k < run; ++k)
+            {
+                result[i + k] = code;
+            }
+        }
+        std::fill(result + i, result + n, code);
+    }
+
+    // Leaves and nodes all offer, for a block of n elements starting at first,
+    //   const FP *eval<mode, contraction>(first, n, scratch, target)
+    // returning the block's values: the array itself for a leaf, else target, which the
+    // node fills. scratch holds the buffers of the node's subtree, `buffers` blocks.
+
+    template <class FP>
+    struct Array
+    {
+        using value_type = FP;
+        static constexpr size_t buffers = 0;
+
+        const FP *data;
+        size_t count;
+
+        size_t size() const { return count; }
+
+        template <Rounding mode, Contraction contraction>
+        const FP *eval(size_t first, size_t, FP *, FP *) const { return data + first; }
+    };
+
+    // One value for every element
+    template <class FP>
+    struct Broadcast
+    {
+        using value_type = FP;
+        static constexpr size_t buffers = 0;
+
+        FP value;
+
+        size_t size() const { return any_size; }
+
+        template <Rounding mode, Contraction contraction>
+        const FP *eval(size_t, size_t n, FP *, FP *target) const
+        {
+            // filled on every block, since a node may overwrite its operand's target
+            fill(target, n, value);
+            return target;
+        }
+    };
+
+    template <class Op, class E>
+    struct Unary
+    {
+        using value_type = typename E::value_type;
+        using FP = value_type;
+        // the operand's target, then its subtree
+        static constexpr size_t buffers = 1 + E::buffers;
+
+        E operand;
+
+        size_t size() const { return operand.size(); }
+
+        template <Rounding mode, Contraction contraction>
+        const FP *eval(size_t first, size_t n, FP *scratch, FP *target) const
+        {
+            const FP *in = operand.template eval<mode, contraction>(first, n, scratch + block, scratch);
+            if constexpr (std::is_same_v<Op, Neg>)
+                negate(in, target, n);
+            else
+                batch_detail::apply<Op, mode>(std::span<const FP>(in, n), std::span<FP>(target, n));
+            return target;
+        }
+    };
+
+    // Whether an expression is a product, which ContractFma may fuse into the addition
+    // it feeds
+    template <class E>
+    constexpr bool is_product = false;
+
+    template <class Op, class L, class R>
+    struct Binary
+    {
+        static_assert(std::is_same_v<typename L::value_type, typename R::value_type>,
+                      "the operands of an expression must have the same format");
+        using value_type = typename L::value_type;
+        using FP = value_type;
+        // left target, left subtree, right target, right subtree
+        static constexpr size_t buffers = 1 + L::buffers + 1 + R::buffers;
+
+        L left;
+        R right;
+
+        size_t size() const
+        {
+            assert(left.size() == any_size || right.size() == any_size || left.size() == right.size());
+            return left.size() == any_size ? right.size() : left.size();
+        }
+
+        // The block of both operands
+        template <Rounding mode, Contraction contraction>
+        void operands(size_t first, size_t n, FP *scratch, const FP *&a, const FP *&b) const
+        {
+            FP *right_scratch = scratch + (1 + L::buffers) * block;
+            a = left.template eval<mode, contraction>(first, n, scratch + block, scratch);
+            b = right.template eval<mode, contraction>(first, n, right_scratch + block, right_scratch);
+        }
+
+        template <Rounding mode, Contraction contraction>
+        const FP *eval(size_t first, size_t n, FP *scratch, FP *target) const
+        {
+            FP *left_target = scratch;
+            FP *right_target = scratch + (1 + L::buffers) * block;
+            constexpr bool additive = std::is_same_v<Op, batch_detail::Add> || std::is_same_v<Op, Sub>;
+            if constexpr (contraction == ContractFma && additive && is_product<L>)
+            { // a * b + c, a * b - c = a * b + (-c)
+                const FP *a, *b;
+                left.template operands<mode, contraction>(first, n, left_target + block, a, b);
+                const FP *c = right.template eval<mode, contraction>(first, n, right_target + block, right_target);
+                if constexpr (std::is_same_v<Op, Sub>)
+                {
+                    negate(c, right_target, n);
+                    c = right_target;
+                }
+                fma_block<mode>(a, b, c, target, n);
+            }
+            else if constexpr (contraction == ContractFma && additive && is_product<R>)
+            { // c + a * b, c - a * b = (-a) * b + c
+                const FP *c = left.template eval<mode, contraction>(first, n, left_target + block, left_target);
+                const FP *a, *b;
+                right.template operands<mode, contraction>(first, n, right_target + block, a, b);
+                if constexpr (std::is_same_v<Op, Sub>)
+                {
+                    // the product's own target is free once it is fused
+                    negate(a, right_target, n);
+                    a = right_target;
+                }
+                fma_block<mode>(a, b, c, target, n);
+            }
+            else
+            {
+                const FP *a, *b;
+                operands<mode, contraction>(first, n, scratch, a, b);
+                if constexpr (std::is_same_v<Op, Sub>)
+                {
+                    negate(b, right_target, n);
+                    b = right_target;
+                }
+                using Kernel = std::conditional_t<std::is_same_v<Op, Sub>, batch_detail::Add, Op>;
+                batch_detail::apply<Kernel, mode>(std::span<const FP>(a, n), std::span<const FP>(b, n), std::span<FP>(target, n));
+            }
+            return target;
+        }
+
+    private:
+        template <Rounding mode>
+        static void fma_block(const FP *a, const FP *b, const FP *c, FP *target, size_t n)
+        {
+            batch_detail::apply<batch_detail::Fma, mode>(std::span<const FP>(a, n), std::span<const FP>(b, n),
+                                                         std::span<const FP>(c, n), std::span<FP>(target, n));
+        }
+    };
+
+    template <class L, class R>
+    constexpr bool is_product<Binary<batch_detail::Mul, L, R>> = true;
+
+    template <class A, class B, class C>
+    struct Fused
+    {
+        static_assert(std::is_same_v<typename A::value_type, typename B::value_type> &&
+                          std::is_same_v<typename A::value_type, typename C::value_type>,
+                      "the operands of an expression must have the same format");
+        using value_type = typename A::value_type;
+        using FP = value_type;
+        static constexpr size_t buffers = 1 + A::buffers + 1 + B::buffers + 1 + C::buffers;
+
+        A a;
+        B b;
+        C c;
+
+        size_t size() const
+        {
+            size_t result = any_size;
+            for (size_t n : {a.size(), b.size(), c.size()})
+            {
+                assert(result == any_size || n == any_size || n == result);
+                result = n == any_size ? result : n;
+            }
+            return result;
+        }
+
+        template <Rounding mode, Contraction contraction>
+        const FP *eval(size_t first, size_t n, FP *scratch, FP *target) const
+        {
+            FP *b_target = scratch + (1 + A::buffers) * block;
+            FP *c_target = b_target + (1 + B::buffers) * block;
+            const FP *x = a.template eval<mode, contraction>(first, n, scratch + block, scratch);
+            const FP *y = b.template eval<mode, contraction>(first, n, b_target + block, b_target);
+            const FP *z = c.template eval<mode, contraction>(first, n, c_target + block, c_target);
+            batch_detail::apply<batch_detail::Fma, mode>(std::span<const FP>(x, n), std::span<const FP>(y, n),
+                                                         std::span<const FP>(z, n), std::span<FP>(target, n));
+            return target;
+        }
+    };
+
+    template <class T>
+    struct is_expression : std::false_type
+    {
+    };
+    template <class FP>
+    struct is_expression<Array<FP>> : std::true_type
+    {
+    };
+    template <class FP>
+    struct is_expression<Broadcast<FP>> : std::true_type
+    {
+    };
+    template <class Op, class E>
+    struct is_expression<Unary<Op, E>> : std::true_type
+    {
+    };
+    template <class Op, class L, class R>
+    struct is_expression<Binary<Op, L, R>> : std::true_type
+    {
+    };
+    template <class A, class B, class C>
+    struct is_expression<Fused<A, B, C>> : std::true_type
+    {
+    };
+
+    template <class T>
+    concept Expression = is_expression<std::remove_cvref_t<T>>::value;
+
+    // Format of the first expression among T...
+    template <class X, class... Rest>
+    constexpr auto value_type_of()
+    {
+        if constexpr (Expression<X>)
+            return std::type_identity<typename X::value_type>{};
+        else
+            return value_type_of<Rest...>();
+    }
+    template <class... T>
+    using value_of = typename decltype(value_type_of<T...>())::type;
+
+    // An operand of an operator: an expression as it is, a single value broadcast
+    template <class E, class FP>
+    auto node(const E &e)
+    {
+        if constexpr (Expression<E>)
+        {
+            return e;
+        }
+        else
+        {
+            static_assert(std::is_same_v<E, FP>, "a single value in an expression must have the expression's format");
+            return Broadcast<FP>{e};
+        }
+    }
+
+    template <class Op, class X, class Y>
+    auto binary(const X &x, const Y &y)
+    {
+        using FP = value_of<X, Y>;
+        using L = decltype(node<X, FP>(x));
+        using R = decltype(node<Y, FP>(y));
+        return Binary<Op, L, R>{node<X, FP>(x), node<Y, FP>(y)};
+    }
+
+    template <class X, class Y>
+        requires(Expression<X> || Expression<Y>)
+    auto operator+(const X &x, const Y &y) { return binary<batch_detail::Add>(x, y); }
+
+    template <class X, class Y>
+        requires(Expression<X> || Expression<Y>)
+    auto operator-(const X &x, const Y &y) { return binary<Sub>(x, y); }
+
+    template <class X, class Y>
+        requires(Expression<X> || Expression<Y>)
+    auto operator*(const X &x, const Y &y) { return binary<batch_detail::Mul>(x, y); }
+
+    template <class X, class Y>
+        requires(Expression<X> || Expression<Y>)
+    auto operator/(const X &x, const Y &y) { return binary<batch_detail::Div>(x, y); }
+
+    template <Expression E>
+    auto operator-(const E &e) { return Unary<Neg, E>{e}; }
+
+    template <Expression E>
+    auto sqrt(const E &e) { return Unary<batch_detail::Sqrt, E>{e}; }
+
+    // fma(a, b, c) rounded once, whatever the Contraction
+    template <class A, class B, class C>
+        requires(Expression<A> || Expression<B> || Expression<C>)
+    auto fma(const A &a, const B &b, const C &c)
+    {
+        using FP = value_of<A, B, C>;
+        return Fused<decltype(node<A, FP>(a)), decltype(node<B, FP>(b)), decltype(node<C, FP>(c))>{
+            node<A, FP>(a), node<B, FP>(b), node<C, FP>(c)};
+    }
+}
+
+// x as a leaf of an expression; the array must outlive the expressions built on it
+template <int exponent, int mantissa, class Traits>
+expr_detail::Array<FloatingPoint<exponent, mantissa, Traits>> lazy(std::span<const FloatingPoint<exponent, mantissa, Traits>> x)
+{
+    return {x.data(), x.size()};
+}
+
+template <int exponent, int mantissa, class Traits>
+expr_detail::Array<FloatingPoint<exponent, mantissa, Traits>> lazy(std::span<FloatingPoint<exponent, mantissa, Traits>> x)
+{
+    return {x.data(), x.size()};
+}
+
+template <int exponent, int mantissa, class Traits>
+expr_detail::Array<FloatingPoint<exponent, mantissa, Traits>> lazy(const std::vector<FloatingPoint<exponent, mantissa, Traits>> &x)
+{
+    return {x.data(), x.size()};
+}
+
+// out[i] = e[i] for every i, a block at a time; out may alias the arrays of e element
+// for element
+template <Rounding mode = RoundNearestEven, Contraction contraction = ContractOff, expr_detail::Expression E>
+void evaluate(const E &e, std::span<typename E::value_type> out)
+{
+    using FP = typename E::value_type;
+    constexpr size_t block = expr_detail::block;
+    assert(e.size() == expr_detail::any_size || e.size() == out.size());
+
+    // the root fills out directly, a leaf root is copied
+    std::vector<FP> scratch(E::buffers * block);
+    for (size_t first = 0; first < out.size(); first += block)
+    {
+        const size_t n = std::min(block, out.size() - first);
+        const FP *result = e.template eval<mode, contraction>(first, n, scratch.data(), out.data() + first);
+        if (result != out.data() + first)
+        {
+            const auto *codes = reinterpret_cast<const typename FP::storage_type *>(result);
+            std::copy(codes, codes + n, reinterpret_cast<typename FP::storage_type *>(out.data() + first));
+        }
+    }
+}
+
+#endif // EXPRESSION_HPP_
@@ -0,0 +1,422 @@
+#ifndef FLOATINGPOINTARRAY_HPP_
+#define FLOATINGPOINTARRAY_HPP_
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <span>
+#include <utility>
+#include <vector>
+#include "Batch.hpp"
+
+// Arrays of FloatingPoint values packed at 1 + exponent + mantissa bits each, element i
+// starting at bit i * width of an array of 64-bit words counted from the low bit, so a
+// <5, 4> array takes 10 bits an element instead of the 16 of its storage type. One
+// spare word after the last keeps every element readable with two loads.
+//
+// Elements are reached through a proxy reference, as in std::vector<bool>. The bulk
+// get() and set() work on groups of 64 elements, which fill exactly width words, so a
+// group unpacks with shifts known at compile time; the batch kernels (add(), mul(),
+// convert(), fma_accumulate(), ...) have overloads that unpack blocks of the operands,
+// run the span kernel and pack the result, giving the same bits and flags as the span
+// kernels on unpacked arrays.
+
+namespace packed_detail
+{
+    template <int width>
+    constexpr uint64_t code_mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+
+    // Element at bit of words; (x << 1) << (63 - s) is x << (64 - s) without the
+    // undefined shift by 64 when the element does not straddle two words
+    template <int width>
+    uint64_t get_bits(const uint64_t *words, uint64_t bit)
+    {
+        const uint64_t *p = words + bit / 64;
+        const int shift = static_cast<int>(bit % 64);
+        return ((p[0] >> shift) | ((p[1] << 1) << (63 - shift))) & code_mask<width>;
+    }
+
+    template <int width>
+    void set_bits(uint64_t *words, uint64_t bit, uint64_t code)
+    {
+        uint64_t *p = words + bit / 64;
+        const int shift = static_cast<int>(bit % 64);
+        p[0] = (p[0] & ~(code_mask<width> << shift)) | (code << shift);
+        if (shift + width > 64)
+        {
+            p[1] = (p[1] & ~(code_mask<width> >> (64 - shift))) | (code >> (64 - shift));
+        }
+    }
+
+    // 64 elements starting on a word boundary fill width words. The group is spelled
+    // out over an index pack so that every shift and word offset is a constant
+    template <int width, class Code, size_t... k>
+    void unpack_group(const uint64_t *words, Code *codes, std::index_sequence<k...>)
+    {
+        ((codes[k] = static_cast<Code>(get_bits<width>(words, k * width))), ...);
+    }
+
+    template <int width, class Code>
+    void unpack_group(const uint64_t *words, Code *codes)
+    {
+        unpack_group<width>(words, codes, std::make_index_sequence<64>());
+    }
+
+    template <int width, class Code, size_t... k>
+    void pack_group(const Code *codes, uint64_t *words, std::index_sequence<k...>)
+    {
+        std::array<uint64_t, width + 1> group{};
+        ((group[k * width / 64] |= static_cast<uint64_t>(codes[k]) << (k * width % 64),
+          group[k * width / 64 + 1] |= (static_cast<uint64_t>(codes[k]) >> 1) >> (63 - k * width % 64)),
+         ...);
+        std::memcpy(words, group.data(), width * sizeof(uint64_t));
+    }
+
+    template <int width, class Code>
+    void pack_group(const Code *codes, uint64_t *words)
+    {
+        pack_group<width>(codes, words, std::make_index_sequence<64>());
+    }
+
+    // Elements the batch overloads unpack at a time
+    inline constexpr size_t block = 256;
+}
+
+template <int exponent, int mantissa, class Traits = IEEETraits>
+class FloatingPointArray
+{
+public:
+    using value_type = FloatingPoint<exponent, mantissa, Traits>;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    static constexpr int width = 1 + exponent + mantissa;
+
+    static_assert(std::is_standard_layout_v<value_type> && sizeof(value_type) == sizeof(typename value_type::storage_type),
+                  "packed arrays hold FloatingPoint values as their encodings");
+
+    // Proxy for one element
+    class reference
+    {
+    public:
+        operator value_type() const { return array->get(index); }
+        reference &operator=(const value_type &value)
+        {
+            array->set(index, value);
+            return *this;
+        }
+        reference &operator=(const reference &other) { return *this = static_cast<value_type>(other); }
+
+        friend void swap(reference a, reference b)
+        {
+            const value_type value = a;
+            a = static_cast<value_type>(b);
+            b = value;
+        }
+
+    private:
+        friend class FloatingPointArray;
+        reference(FloatingPointArray *array, size_t index) : array(array), index(index) {}
+
+        FloatingPointArray *array;
+        size_t index;
+    };
+
+    template <bool is_const>
+    class basic_iterator
+    {
+        using Array = std::conditional_t<is_const, const FloatingPointArray, FloatingPointArray>;
+
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = FloatingPointArray::value_type;
+        using difference_type = ptrdiff_t;
+        using reference = std::conditional_t<is_const, value_type, FloatingPointArray::reference>;
+        using pointer = void;
+
+        basic_iterator() = default;
+        basic_iterator(Array *array, size_t index) : array(array), index(index) {}
+        // iterator to const_iterator
+        template <bool other_const, class = std::enable_if_t<is_const && !other_const>>
+        basic_iterator(const basic_iterator<other_const> &other) : array(other.array), index(other.index) {}
+
+        reference operator*() const { return (*array)[index]; }
+        reference operator[](difference_type n) const { return (*array)[index + n]; }
+
+        basic_iterator &operator++() { return ++index, *this; }
+        basic_iterator &operator--() { return --index, *this; }
+        basic_iterator operator++(int) { return basic_iterator(array, index++); }
+        basic_iterator operator--(int) { return basic_iterator(array, index--); }
+        basic_iterator &operator+=(difference_type n) { return index += n, *this; }
+        basic_iterator &operator-=(difference_type n) { return index -= n, *this; }
+        friend basic_iterator operator+(basic_iterator it, difference_type n) { return it += n; }
+        friend basic_iterator operator+(difference_type n, basic_iterator it) { return it += n; }
+        friend basic_iterator operator-(basic_iterator it, difference_type n) { return it -= n; }
+        friend difference_type operator-(const basic_iterator &a, const basic_iterator &b)
+        {
+            return static_cast<difference_type>(a.index) - static_cast<difference_type>(b.index);
+        }
+        friend bool operator==(const basic_iterator &a, const basic_iterator &b) { return a.index == b.index; }
+        friend auto operator<=>(const basic_iterator &a, const basic_iterator &b) { return a.index <=> b.index; }
+
+    private:
+        template <bool>
+        friend class basic_iterator;
+
+        Array *array = nullptr;
+        size_t index = 0;
+    };
+
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+
+    FloatingPointArray() : words(1, 0) {}
+
+    // size zeros
+    explicit FloatingPointArray(size_t size) : count(size), words(word_count(size), 0) {}
+
+    FloatingPointArray(size_t size, const value_type &value) : FloatingPointArray(size)
+    {
+        std::fill(begin(), end(), value);
+    }
+
+    explicit FloatingPointArray(std::span<const value_type> values) : FloatingPointArray(values.size())
+    {
+        set(0, values);
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    // bytes of packed storage, the spare word included
+    size_t bytes() const { return words.size() * sizeof(uint64_t); }
+    // the packed words, element i at bit i * width
+    const uint64_t *data() const { return words.data(); }
+
+    // Elements past the old size are zero
+    void resize(size_t size)
+    {
+        // clear the bits of dropped elements so that growing again reads zeros
+        for (size_t i = size; i < count; ++i)
+            set(i, value_type());
+        count = size;
+        words.resize(word_count(size), 0);
+    }
+
+    value_type get(size_t i) const
+    {
+        assert(i < count);
+        const auto code = static_cast<storage_type>(packed_detail::get_bits<width>(words.data(), static_cast<uint64_t>(i) * width));
+        return value_type::from_bits(code);
+    }
+
+    void set(size_t i, const value_type &value)
+    {
+        assert(i < count);
+        packed_detail::set_bits<width>(words.data(), static_cast<uint64_t>(i) * width, code_of(value));
+    }
+
+    value_type operator[](size_t i) const { return get(i); }
+    reference operator[](size_t i) { return reference(this, i); }
+
+    // out[k] = element first + k
+    void get(size_t first, std::span<value_type> out) const
+    {
+        assert(first + out.size() <= count);
+        storage_type *codes = reinterpret_cast<storage_type *>(out.data());
+        const size_t last = first + out.size();
+        size_t i = first;
+        for (; i < last && i % 64 != 0; ++i)
+            codes[i - first] = static_cast<storage_type>(packed_detail::get_bits<width>(words.data(), uint64_t(i) * width));
+        for (; i + 64 <= last; i += 64)
+            packed_detail::unpack_group<width>(words.data() + i / 64 * width, codes + (i - first));
+        for (; i < last; ++i)
+            codes[i - first] = static_cast<storage_type>(packed_detail::get_bits<width>(words.data(), uint64_t(i) * width));
+    }
+
+    // element first + k = in[k]
+    void set(size_t first, std::span<const value_type> in)
+    {
+        assert(first + in.size() <= count);
+        const storage_type *codes = reinterpret_cast<const storage_type *>(in.data());
+        const size_t last = first + in.size();
+        size_t i = first;
+        for (; i < last && i % 64 != 0; ++i)
+            packed_detail::set_bits<width>(words.data(), uint64_t(i) * width, codes[i - first]);
+        for (; i + 64 <= last; i += 64)
+            packed_detail::pack_group<width>(codes + (i - first), words.data() + i / 64 * width);
+        for (; i < last; ++i)
+            packed_detail::set_bits<width>(words.data(), uint64_t(i) * width, codes[i - first]);
+    }
+
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, count); }
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, count); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+private:
+    using storage_type = typename value_type::storage_type;
+
+    static size_t word_count(size_t size) { return (size * width + 63) / 64 + 1; }
+
+    static uint64_t code_of(const value_type &value)
+    {
+        return value.to_bits();
+    }
+
+    size_t count = 0;
+    std::vector<uint64_t> words;
+};
+
+namespace packed_detail
+{
+    // out = kernel(a) a block at a time; out may be a
+    template <class FP, class OutArray, class InArray, class Kernel>
+    void apply(const InArray &a, OutArray &out, Kernel kernel)
+    {
+        using In = typename InArray::value_type;
+        assert(a.size() == out.size());
+        std::array<In, block> x;
+        std::array<FP, block> result;
+        for (size_t first = 0; first < a.size(); first += block)
+        {
+            const size_t n = std::min(block, a.size() - first);
+            a.get(first, std::span<In>(x.data(), n));
+            kernel(std::span<const In>(x.data(), n), std::span<FP>(result.data(), n));
+            out.set(first, std::span<const FP>(result.data(), n));
+        }
+    }
+
+    // out = kernel(a, b) a block at a time; out may be a or b
+    template <class FP, class Array, class Kernel>
+    void apply(const Array &a, const Array &b, Array &out, Kernel kernel)
+    {
+        assert(a.size() == b.size() && a.size() == out.size());
+        std::array<FP, block> x, y, result;
+        for (size_t first = 0; first < a.size(); first += block)
+        {
+            const size_t n = std::min(block, a.size() - first);
+            a.get(first, std::span<FP>(x.data(), n));
+            b.get(first, std::span<FP>(y.data(), n));
+            kernel(std::span<const FP>(x.data(), n), std::span<const FP>(y.data(), n), std::span<FP>(result.data(), n));
+            out.set(first, std::span<const FP>(result.data(), n));
+        }
+    }
+}
+
+// Element-wise kernels of Batch.hpp over packed arrays; out may alias an operand
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void add(const FloatingPointArray<exponent, mantissa, Traits> &a, const FloatingPointArray<exponent, mantissa, Traits> &b,
+         FloatingPointArray<exponent, mantissa, Traits> &out)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    packed_detail::apply<FP>(a, b, out, [](auto x, auto y, auto r)
+                             { add<mode>(x, y, r); });
+}
+
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void mul(const FloatingPointArray<exponent, mantissa, Traits> &a, const FloatingPointArray<exponent, mantissa, Traits> &b,
+         FloatingPointArray<exponent, mantissa, Traits> &out)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    packed_detail::apply<FP>(a, b, out, [](auto x, auto y, auto r)
+                             { mul<mode>(x, y, r); });
+}
+
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void div(const FloatingPointArray<exponent, mantissa, Traits> &a, const FloatingPointArray<exponent, mantissa, Traits> &b,
+         FloatingPointArray<exponent, mantissa, Traits> &out)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    packed_detail::apply<FP>(a, b, out, [](auto x, auto y, auto r)
+                             { div<mode>(x, y, r); });
+}
+
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void pow(const FloatingPointArray<exponent, mantissa, Traits> &a, const FloatingPointArray<exponent, mantissa, Traits> &b,
+         FloatingPointArray<exponent, mantissa, Traits> &out)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    packed_detail::apply<FP>(a, b, out, [](auto x, auto y, auto r)
+                             { pow<mode>(x, y, r); });
+}
+
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void reciprocal(const FloatingPointArray<exponent, mantissa, Traits> &a, FloatingPointArray<exponent, mantissa, Traits> &out)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    packed_detail::apply<FP>(a, out, [](auto x, auto r)
+                             { reciprocal<mode>(x, r); });
+}
+
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void sqrt(const FloatingPointArray<exponent, mantissa, Traits> &a, FloatingPointArray<exponent, mantissa, Traits> &out)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    packed_detail::apply<FP>(a, out, [](auto x, auto r)
+                             { sqrt<mode>(x, r); });
+}
+
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void exp(const FloatingPointArray<exponent, mantissa, Traits> &a, FloatingPointArray<exponent, mantissa, Traits> &out)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    packed_detail::apply<FP>(a, out, [](auto x, auto r)
+                             { exp<mode>(x, r); });
+}
+
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void exp2(const FloatingPointArray<exponent, mantissa, Traits> &a, FloatingPointArray<exponent, mantissa, Traits> &out)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    packed_detail::apply<FP>(a, out, [](auto x, auto r)
+                             { exp2<mode>(x, r); });
+}
+
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void log(const FloatingPointArray<exponent, mantissa, Traits> &a, FloatingPointArray<exponent, mantissa, Traits> &out)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    packed_detail::apply<FP>(a, out, [](auto x, auto r)
+                             { log<mode>(x, r); });
+}
+
+template <Rounding mode = RoundNearestEven, int exponent, int mantissa, class Traits>
+void log2(const FloatingPointArray<exponent, mantissa, Traits> &a, FloatingPointArray<exponent, mantissa, Traits> &out)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    packed_detail::apply<FP>(a, out, [](auto x, auto r)
+                             { log2<mode>(x, r); });
+}
+
+// out[i] = in[i] rounded into the format of out
+template <Rounding mode = RoundNearestEven, int SrcE, int SrcM, class SrcTraits, int DstE, int DstM, class DstTraits>
+void convert(const FloatingPointArray<SrcE, SrcM, SrcTraits> &in, FloatingPointArray<DstE, DstM, DstTraits> &out)
+{
+    using Dst = FloatingPoint<DstE, DstM, DstTraits>;
+    packed_detail::apply<Dst>(in, out, [](auto x, auto r)
+                              { convert<mode>(x, r); });
+}
+
+// acc = fma(a[i], b[i], acc) for i = 0, 1, ..., as fma_accumulate() over spans
+template <int exponent, int mantissa, class Traits>
+void fma_accumulate(const FloatingPointArray<exponent, mantissa, Traits> &a, const FloatingPointArray<exponent, mantissa, Traits> &b,
+                    FloatingPoint<exponent, mantissa, Traits> &acc)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    assert(a.size() == b.size());
+    std::array<FP, packed_detail::block> x, y;
+    for (size_t first = 0; first < a.size(); first += packed_detail::block)
+    {
+        const size_t n = std::min(packed_detail::block, a.size() - first);
+        a.get(first, std::span<FP>(x.data(), n));
+        b.get(first, std::span<FP>(y.data(), n));
+        fma_accumulate(std::span<const FP>(x.data(), n), std::span<const FP>(y.data(), n), acc);
+    }
+}
+
+#endif // FLOATINGPOINTARRAY_HPP_
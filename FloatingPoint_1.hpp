@@ -1,1336 +1,2449 @@
-#ifndef FLOATINGPOINT_HPP_
-#define FLOATINGPOINT_HPP_
-
-#include <cstdint>
-#include <string>
-#include <iostream>
-#include <cmath>
-#include <iomanip>
-#include <bitset>
-
-typedef enum STATE
-{
-    Normal,
-    Subnormal,
-    Zero,
-    Inf,
-    Nan
-} State;
-
-// 找到左数第一个一
-int findFirstOneBit(uint64_t bin_value)
-{
-    if (bin_value == 0)
-        return 0;
-    return 63 - __builtin_clzll(bin_value);
-}
-
-// 1,8,23表示的floatingpoint转换为float
-float binary32_to_float(uint32_t binary)
-{
-    float result;
-    memcpy(&result, &binary, sizeof(float));
-    return result;
-}
-
-// 1,11,52表示的floatingpoint转换为double
-double binary64_to_double(uint64_t binary)
-{
-    double result;
-    memcpy(&result, &binary, sizeof(double));
-    return result;
-}
-
-template <int exponent, int mantissa>
-class FloatingPoint
-{
-private:
-    bool sign;
-    uint64_t E_value;
-    int E_length = exponent;
-    uint64_t E_mask = (1ULL << exponent) - 1;
-
-    uint64_t M_value;
-    int M_length = mantissa;
-    uint64_t M_mask = (1ULL << mantissa) - 1;
-
-    State state;
-
-    void update_state()
-    {
-        if (E_value == 0 && M_value == 0)
-        {
-            state = Zero;
-        }
-        else if (E_value == 0 && M_value != 0)
-        {
-            state = Subnormal;
-        }
-        else if (E_value == E_mask && M_value == 0)
-        {
-            state = Inf;
-        }
-        else if (E_value == E_mask && M_value != 0)
-        {
-            state = Nan;
-        }
-        else
-        {
-            state = Normal;
-        }
-    }
-
-public:
-    bool get_sign() const { return sign; }
-    uint64_t get_E_value() const { return E_value; }
-    uint64_t get_M_value() const { return M_value; }
-    int get_E_length() const { return E_length; }
-    int get_M_length() const { return M_length; }
-    uint64_t get_E_mask() const { return E_mask; }
-    uint64_t get_M_mask() const { return M_mask; }
-
-    // Print the state of the floating point number
-    void print_state() const
-    {
-        std::cout << "Decimal: " << To_decimal() << std::endl;
-        std::cout << "Sign: " << sign << "\n";
-        std::cout << "Exponent: 0b" << std::bitset<exponent>(E_value) << "\n";
-        std::cout << "Mantissa: 0b" << std::bitset<mantissa>(M_value) << "\n";
-        std::cout << "State: ";
-        switch (state)
-        {
-        case Normal:
-            std::cout << "Normal\n";
-            break;
-        case Subnormal:
-            std::cout << "Subnormal\n";
-            break;
-        case Zero:
-            std::cout << "Zero\n";
-            break;
-        case Inf:
-            std::cout << "Inf\n";
-            break;
-        case Nan:
-            std::cout << "NaN\n";
-            break;
-        }
-    }
-
-    State update_state(FloatingPoint value) const
-    {
-        if (value.E_value == 0 && value.M_value == 0)
-        {
-            return Zero;
-        }
-        else if (value.E_value == 0 && value.M_value != 0)
-        {
-            return Subnormal;
-        }
-        else if (value.E_value == value.E_mask && value.M_value == 0)
-        {
-            return Inf;
-        }
-        else if (value.E_value == value.E_mask && value.M_value != 0)
-        {
-            return Nan;
-        }
-        else
-        {
-            return Normal;
-        }
-    }
-
-    double To_decimal() const
-    {
-        uint64_t bias = E_mask >> 1;
-
-        uint64_t E = static_cast<uint64_t>(E_value & E_mask);
-        if (E == 0)
-        {
-            double base = 0;
-            E = 1ULL - bias;
-        }
-        else
-        {
-            E -= bias;
-        }
-
-        double M = M_value & M_mask;
-        if (E != 1ULL - bias)
-        {
-            M += (M_mask + 1);
-        }
-        else
-        {
-            E = 0;
-            M = 0;
-        }
-
-        double result = std::pow(2.0, E) * M / (M_mask + 1);
-
-        if (sign)
-        {
-            result = -result;
-        }
-
-        return result;
-    }
-
-    static FloatingPoint<exponent, mantissa> createInfinity(bool sign)
-    {
-        FloatingPoint<exponent, mantissa> result;
-        result.sign = sign;
-        result.E_value = ((1ULL << exponent) - 1);
-        result.M_value = 0;
-        result.state = Inf;
-        return result;
-    }
-
-    static FloatingPoint<exponent, mantissa> createZero()
-    {
-        FloatingPoint<exponent, mantissa> result;
-        result.sign = 0;
-        result.E_value = 0;
-        result.M_value = 0;
-        result.state = Zero;
-        return result;
-    }
-
-    // change the floatingpoint into binary form
-    template <int other_exponent, int other_mantissa>
-    uint64_t Bin(FloatingPoint<other_exponent, other_mantissa> value) const
-    {
-        uint64_t result = (value.get_sign() << (value.get_E_length() + value.get_M_length())) |
-                          ((value.get_E_value()) << value.get_M_length()) |
-                          (value.get_M_value());
-        return result;
-    }
-
-    // Default: Initialize to Floating Point 0
-    FloatingPoint() : sign(false), E_value(0), M_value(0), state(Zero) {}
-
-    // Initialize with binary value
-    FloatingPoint(const uint64_t val_binary)
-    {
-        sign = (val_binary >> (exponent + mantissa)) & 1;
-        E_value = (val_binary >> mantissa) & (E_mask);
-        M_value = val_binary & (M_mask);
-        update_state();
-    }
-
-    // Initialize with class type
-    FloatingPoint(bool sign, uint64_t E_value, uint64_t M_value) : sign(sign), E_value(E_value), M_value(M_value)
-    {
-        update_state();
-    }
-
-    // Initialize with int value
-    FloatingPoint(int value)
-    {
-        sign = (value < 0);
-        if (value < 0)
-            value = -value;
-        int F1 = findFirstOneBit(value);
-        E_value = F1 + (E_mask >> 1);
-        M_value = (value & ((1ULL << F1) - 1)) << (mantissa - F1);
-        update_state();
-    }
-
-    // Initialize with float value
-    FloatingPoint(float value)
-    {
-        uint32_t bin_value = *reinterpret_cast<uint32_t *>(&value);
-        // std::cout << std::bitset<32>(bin_value) << std::endl;
-        FloatingPoint temp = std::move(Trans(8, 23, bin_value));
-        sign = temp.get_sign();
-        E_value = temp.get_E_value();
-        M_value = temp.get_M_value();
-        update_state();
-    }
-
-    // Initialize with double value
-    FloatingPoint(double value)
-    {
-        uint64_t bin_value = *reinterpret_cast<uint64_t *>(&value);
-        // std::cout << std::bitset<64>(bin_value) << std::endl;
-        FloatingPoint temp = std::move(Trans(11, 52, bin_value));
-        sign = temp.get_sign();
-        E_value = temp.get_E_value();
-        M_value = temp.get_M_value();
-        update_state();
-    }
-
-    // Initialize with other floatingpoint value
-    template <int other_exponent, int other_mantissa>
-    FloatingPoint(const FloatingPoint<other_exponent, other_mantissa> &value)
-    {
-        uint64_t bin_value = Bin(value);
-        // std::cout << std::bitset<64>(bin_value) << std::endl;
-        FloatingPoint temp = std::move(Trans(other_exponent, other_mantissa, bin_value));
-        sign = temp.get_sign();
-        E_value = temp.get_E_value();
-        M_value = temp.get_M_value();
-        update_state();
-    }
-
-    // Initialize with other floatingpoint value
-    template <int other_exponent, int other_mantissa>
-    FloatingPoint(const FloatingPoint<other_exponent, other_mantissa> &&value)
-    {
-        uint64_t bin_value = Bin(value);
-        // std::cout << std::bitset<64>(bin_value) << std::endl;
-        FloatingPoint temp = std::move(Trans(other_exponent, other_mantissa, bin_value));
-        sign = temp.get_sign();
-        E_value = temp.get_E_value();
-        M_value = temp.get_M_value();
-        update_state();
-    }
-
-    template <int other_exponent, int other_mantissa>
-    FloatingPoint &operator=(const FloatingPoint<other_exponent, other_mantissa> &value)
-    {
-        uint64_t bin_value = Bin(value);
-        // std::cout << std::bitset<64>(bin_value) << std::endl;
-        FloatingPoint temp = std::move(Trans(other_exponent, other_mantissa, bin_value));
-        sign = temp.get_sign();
-        E_value = temp.get_E_value();
-        M_value = temp.get_M_value();
-        update_state();
-
-        return *this;
-    }
-
-    template <int other_exponent, int other_mantissa>
-    FloatingPoint &operator=(const FloatingPoint<other_exponent, other_mantissa> &&value)
-    {
-        uint64_t bin_value = Bin(value);
-        // std::cout << std::bitset<64>(bin_value) << std::endl;
-        FloatingPoint temp = std::move(Trans(other_exponent, other_mantissa, bin_value));
-        sign = temp.get_sign();
-        E_value = temp.get_E_value();
-        M_value = temp.get_M_value();
-        update_state();
-
-        return *this;
-    }
-
-    FloatingPoint &operator=(int value)
-    {
-        return FloatingPoint(value);
-    }
-
-    FloatingPoint &operator=(float value)
-    {
-        return FloatingPoint(value);
-    }
-
-    FloatingPoint &operator=(double value)
-    {
-        return FloatingPoint(value);
-    }
-
-    FloatingPoint &operator=(uint64_t value)
-    {
-        return FloatingPoint(value);
-    }
-
-    FloatingPoint Trans(int L_E, int L_M, uint64_t bin_value)
-    {
-        int L_S = 1;
-        uint64_t S_other_mask = (0b1ULL << L_S) - 1;
-        uint64_t E_other_mask = (0b1ULL << L_E) - 1;
-        uint64_t M_other_mask = (0b1ULL << L_M) - 1;
-        bool new_sign = (bin_value >> (L_E + L_M)) & S_other_mask;
-        uint64_t E_other = (bin_value >> L_M) & E_other_mask;
-        uint64_t M_other = bin_value & M_other_mask;
-        uint64_t new_E_value, new_M_value;
-
-        if (exponent > L_E && mantissa >= L_M)
-        {
-            if (E_other == 0 && M_other == 0)
-            { // zero
-                new_E_value = 0;
-                new_M_value = 0;
-            }
-            else if (E_other == 0 && M_other != 0)
-            { // subnormal
-                new_E_value = 0;
-                new_M_value = M_other << (mantissa - L_M);
-            }
-            else if (E_other == (E_other_mask) && M_other == 0)
-            { // infinity
-                new_E_value = E_mask;
-                new_M_value = 0;
-            }
-            else if (E_other == (E_other_mask) && M_other != 0)
-            { // NAN
-                new_E_value = E_mask;
-                new_M_value = M_other << (mantissa - L_M);
-            }
-            else
-            { // normal
-                new_E_value = E_other + (E_mask >> 1) - (E_other_mask >> 1);
-                new_M_value = M_other << (mantissa - L_M);
-            }
-        }
-        else if (exponent > L_E && mantissa < L_M)
-        {
-            if (E_other == 0 && M_other == 0)
-            { // zero
-                new_E_value = 0;
-                new_M_value = 0;
-            }
-            else if (E_other == 0 && M_other != 0)
-            { // subnormal
-                new_E_value = 0;
-                new_M_value = M_other >> (L_M - mantissa);
-            }
-            else if (E_other == (E_other_mask) && M_other == 0)
-            { // infinity
-                new_E_value = E_mask;
-                new_M_value = 0;
-            }
-            else if (E_other == (E_other_mask) && M_other != 0)
-            { // NAN
-                new_E_value = E_mask;
-                new_M_value = M_other >> (L_M - mantissa);
-            }
-            else
-            { // normal
-                new_E_value = E_other + (E_mask >> 1) - (E_other_mask >> 1);
-                if ((M_other & ((0b1ULL << (L_M - mantissa)) - 1)) != 0)
-                {
-                    new_M_value = (M_other >> (L_M - mantissa)) + 1;
-                    if (new_M_value > M_mask)
-                    {
-                        new_E_value += 1;
-                        new_M_value -= (M_mask + 1);
-                    }
-                }
-                else
-                {
-                    new_M_value = M_other >> (L_M - mantissa);
-                }
-            }
-        }
-        else if (exponent < L_E && mantissa >= L_M)
-        {
-            if (E_other == 0 && M_other == 0)
-            { // zero
-                new_E_value = 0;
-                new_M_value = 0;
-            }
-            else if (E_other == 0 && M_other != 0)
-            { // subnormal
-                new_E_value = 0;
-                new_M_value = M_other << (mantissa - L_M);
-            }
-            else if (E_other == (E_other_mask) && M_other == 0)
-            { // infinity
-                new_E_value = E_mask;
-                new_M_value = 0;
-            }
-            else if (E_other == (E_other_mask) && M_other != 0)
-            { // NAN
-                new_E_value = E_mask;
-                new_M_value = M_other << (mantissa - L_M);
-            }
-            else
-            { // normal
-                if (E_other > (E_mask >> 1) + (E_other_mask >> 1))
-                { // infinity
-                    new_E_value = E_mask;
-                    new_M_value = 0;
-                }
-                else if (E_other + (E_mask >> 1) < 0b1 + (E_other_mask >> 1))
-                {
-                    new_E_value = 0;
-                    if ((E_other_mask >> 1) - E_other >= mantissa + (E_mask >> 1))
-                    { // subnormal
-                        new_M_value = 0b1;
-                    }
-                    else
-                    { // normal
-                        M_other <<= (mantissa - L_M);
-                        uint64_t temp = (M_other >> 1) | ((M_mask >> 1) + 1);
-                        M_other = temp >> ((E_other_mask >> 1) - E_other - (E_mask >> 1));
-                        if (temp > (M_other << ((E_other_mask >> 1) - E_other - (E_mask >> 1))))
-                        {
-                            new_M_value = M_other + 1;
-                            if (new_M_value > M_mask)
-                            {
-                                new_E_value += 1;
-                                new_M_value -= (M_mask + 1);
-                            }
-                        }
-                        else
-                        {
-                            new_M_value = M_other;
-                        }
-                    }
-                }
-                else
-                {
-                    new_E_value = E_other + (E_mask >> 1) - (E_other_mask >> 1);
-                    new_M_value = M_other << (mantissa - L_M);
-                }
-            }
-        }
-        else if (L_E == exponent && L_M == mantissa)
-        {
-            new_E_value = E_other;
-            new_M_value = M_other;
-        }
-        else
-        {
-            if (E_other == 0 && M_other == 0)
-            { // zero
-                new_E_value = 0;
-                new_M_value = 0;
-            }
-            else if (E_other == 0 && M_other != 0)
-            { // subnormal
-                new_E_value = 0;
-                new_M_value = 0b1;
-            }
-            else if (E_other == (E_other_mask) && M_other == 0)
-            { // infinity
-                new_E_value = E_mask;
-                new_M_value = 0;
-            }
-            else if (E_other == (E_other_mask) && M_other != 0)
-            { // NAN
-                new_E_value = E_mask;
-                new_M_value = M_other >> (L_M - mantissa);
-            }
-            else
-            { // normal
-                if (E_other > (E_mask >> 1) + (E_other_mask >> 1))
-                { // infinity
-                    new_E_value = E_mask;
-                    new_M_value = 0;
-                }
-                else if (E_other + (E_mask >> 1) < 0b1 + (E_other_mask >> 1))
-                {
-                    new_E_value = 0;
-                    if ((E_other_mask >> 1) - E_other >= mantissa + (E_mask >> 1))
-                    { // subnormal
-                        new_M_value = 0b1;
-                    }
-                    else
-                    { // normal
-                        uint64_t temp = (M_other >> 1) | ((M_other_mask >> 1) + 1);
-                        M_other = temp >> ((E_other_mask >> 1) - E_other - (E_mask >> 1));
-                        if (((M_other & ((0b1ULL << (L_M - mantissa)) - 1)) != 0) || (temp > (M_other << ((E_other_mask >> 1) - E_other - (E_mask >> 1)))))
-                        {
-                            new_M_value = (M_other >> (L_M - mantissa)) + 1;
-                            if (new_M_value > M_mask)
-                            {
-                                new_E_value += 1;
-                                new_M_value -= (M_mask + 1);
-                            }
-                        }
-                        else
-                        {
-                            new_M_value = M_other >> (L_M - mantissa);
-                        }
-                    }
-                }
-                else
-                {
-                    new_E_value = E_other + (E_mask >> 1) - (E_other_mask >> 1);
-                    if ((M_other & ((0b1ULL << (L_M - mantissa)) - 1)) != 0)
-                    {
-                        new_M_value = (M_other >> (L_M - mantissa)) + 1;
-                        if (new_M_value > M_mask)
-                        {
-                            new_E_value += 1;
-                            new_M_value -= (M_mask + 1);
-                        }
-                    }
-                    else
-                    {
-                        new_M_value = M_other >> (L_M - mantissa);
-                    }
-                }
-            }
-        }
-        return FloatingPoint(new_sign, new_E_value, new_M_value);
-    }
-
-    template <int Newexponent, int Newmantissa>
-    FloatingPoint<Newexponent, Newmantissa> Trans_(int L_E, int L_M, uint64_t bin_value) const
-    {
-        uint64_t E_new_mask = (0b1ULL << Newexponent) - 1;
-        uint64_t M_new_mask = (0b1ULL << Newmantissa) - 1;
-        int L_S = 1;
-        uint64_t S_other_mask = (0b1ULL << L_S) - 1;
-        uint64_t E_other_mask = (0b1ULL << L_E) - 1;
-        uint64_t M_other_mask = (0b1ULL << L_M) - 1;
-        bool new_sign = (bin_value >> (L_E + L_M)) & S_other_mask;
-        uint64_t E_other = (bin_value >> L_M) & E_other_mask;
-        uint64_t M_other = bin_value & M_other_mask;
-        uint64_t new_E_value, new_M_value;
-
-        if (Newexponent > L_E && Newmantissa >= L_M)
-        {
-            if (E_other == 0 && M_other == 0)
-            { // zero
-                new_E_value = 0;
-                new_M_value = 0;
-            }
-            else if (E_other == 0 && M_other != 0)
-            { // subnormal
-                new_E_value = 0;
-                new_M_value = M_other << (Newmantissa - L_M);
-            }
-            else if (E_other == (E_other_mask) && M_other == 0)
-            { // infinity
-                new_E_value = E_new_mask;
-                new_M_value = 0;
-            }
-            else if (E_other == (E_other_mask) && M_other != 0)
-            { // NAN
-                new_E_value = E_new_mask;
-                new_M_value = M_other << (Newmantissa - L_M);
-            }
-            else
-            { // normal
-                new_E_value = E_other + (E_new_mask >> 1) - (E_other_mask >> 1);
-                new_M_value = M_other << (Newmantissa - L_M);
-            }
-        }
-        else if (Newexponent > L_E && Newmantissa < L_M)
-        {
-            if (E_other == 0 && M_other == 0)
-            { // zero
-                new_E_value = 0;
-                new_M_value = 0;
-            }
-            else if (E_other == 0 && M_other != 0)
-            { // subnormal
-                new_E_value = 0;
-                new_M_value = M_other >> (L_M - Newmantissa);
-            }
-            else if (E_other == (E_other_mask) && M_other == 0)
-            { // infinity
-                new_E_value = E_new_mask;
-                new_M_value = 0;
-            }
-            else if (E_other == (E_other_mask) && M_other != 0)
-            { // NAN
-                new_E_value = E_new_mask;
-                new_M_value = M_other >> (L_M - Newmantissa);
-            }
-            else
-            { // normal
-                new_E_value = E_other + (E_new_mask >> 1) - (E_other_mask >> 1);
-                if ((M_other & ((0b1ULL << (L_M - Newmantissa)) - 1)) != 0)
-                {
-                    new_M_value = (M_other >> (L_M - Newmantissa)) + 1;
-                    if (new_M_value > M_new_mask)
-                    {
-                        new_E_value += 1;
-                        new_M_value -= (M_new_mask + 1);
-                    }
-                }
-                else
-                {
-                    new_M_value = M_other >> (L_M - Newmantissa);
-                }
-            }
-        }
-        else if (Newexponent < L_E && Newmantissa >= L_M)
-        {
-            if (E_other == 0 && M_other == 0)
-            { // zero
-                new_E_value = 0;
-                new_M_value = 0;
-            }
-            else if (E_other == 0 && M_other != 0)
-            { // subnormal
-                new_E_value = 0;
-                new_M_value = M_other << (Newmantissa - L_M);
-            }
-            else if (E_other == (E_other_mask) && M_other == 0)
-            { // infinity
-                new_E_value = E_new_mask;
-                new_M_value = 0;
-            }
-            else if (E_other == (E_other_mask) && M_other != 0)
-            { // NAN
-                new_E_value = E_new_mask;
-                new_M_value = M_other << (Newmantissa - L_M);
-            }
-            else
-            { // normal
-                if (E_other > (E_new_mask >> 1) + (E_other_mask >> 1))
-                { // infinity
-                    new_E_value = E_new_mask;
-                    new_M_value = 0;
-                }
-                else if (E_other + (E_new_mask >> 1) < 0b1 + (E_other_mask >> 1))
-                {
-                    new_E_value = 0;
-                    if ((E_other_mask >> 1) - E_other >= Newmantissa + (E_new_mask >> 1))
-                    { // subnormal
-                        new_M_value = 0b1;
-                    }
-                    else
-                    { // normal
-                        M_other <<= (Newmantissa - L_M);
-                        uint64_t temp = (M_other >> 1) | ((M_new_mask >> 1) + 1);
-                        M_other = temp >> ((E_other_mask >> 1) - E_other - (E_new_mask >> 1));
-                        if (temp > (M_other << ((E_other_mask >> 1) - E_other - (E_new_mask >> 1))))
-                        {
-                            new_M_value = M_other + 1;
-                            if (new_M_value > M_new_mask)
-                            {
-                                new_E_value += 1;
-                                new_M_value -= (M_new_mask + 1);
-                            }
-                        }
-                        else
-                        {
-                            new_M_value = M_other;
-                        }
-                    }
-                }
-                else
-                {
-                    new_E_value = E_other + (E_new_mask >> 1) - (E_other_mask >> 1);
-                    new_M_value = M_other << (Newmantissa - L_M);
-                }
-            }
-        }
-        else if (L_E == Newexponent && L_M == Newmantissa)
-        {
-            new_E_value = E_other;
-            new_M_value = M_other;
-        }
-        else
-        {
-            if (E_other == 0 && M_other == 0)
-            { // zero
-                new_E_value = 0;
-                new_M_value = 0;
-            }
-            else if (E_other == 0 && M_other != 0)
-            { // subnormal
-                new_E_value = 0;
-                new_M_value = 0b1;
-            }
-            else if (E_other == (E_other_mask) && M_other == 0)
-            { // infinity
-                new_E_value = E_new_mask;
-                new_M_value = 0;
-            }
-            else if (E_other == (E_other_mask) && M_other != 0)
-            { // NAN
-                new_E_value = E_new_mask;
-                new_M_value = M_other >> (L_M - Newmantissa);
-            }
-            else
-            { // normal
-                if (E_other > (E_new_mask >> 1) + (E_other_mask >> 1))
-                { // infinity
-                    new_E_value = E_new_mask;
-                    new_M_value = 0;
-                }
-                else if (E_other + (E_new_mask >> 1) < 0b1 + (E_other_mask >> 1))
-                {
-                    new_E_value = 0;
-                    if ((E_other_mask >> 1) - E_other >= Newmantissa + (E_new_mask >> 1))
-                    { // subnormal
-                        new_M_value = 0b1;
-                    }
-                    else
-                    { // normal
-                        uint64_t temp = (M_other >> 1) | ((M_other_mask >> 1) + 1);
-                        M_other = temp >> ((E_other_mask >> 1) - E_other - (E_new_mask >> 1));
-                        if (((M_other & ((0b1ULL << (L_M - Newmantissa)) - 1)) != 0) || (temp > (M_other << ((E_other_mask >> 1) - E_other - (E_new_mask >> 1)))))
-                        {
-                            new_M_value = (M_other >> (L_M - Newmantissa)) + 1;
-                            if (new_M_value > M_new_mask)
-                            {
-                                new_E_value += 1;
-                                new_M_value -= (M_new_mask + 1);
-                            }
-                        }
-                        else
-                        {
-                            new_M_value = M_other >> (L_M - Newmantissa);
-                        }
-                    }
-                }
-                else
-                {
-                    new_E_value = E_other + (E_new_mask >> 1) - (E_other_mask >> 1);
-                    if ((M_other & ((0b1ULL << (L_M - Newmantissa)) - 1)) != 0)
-                    {
-                        new_M_value = (M_other >> (L_M - Newmantissa)) + 1;
-                        if (new_M_value > M_new_mask)
-                        {
-                            new_E_value += 1;
-                            new_M_value -= (M_new_mask + 1);
-                        }
-                    }
-                    else
-                    {
-                        new_M_value = M_other >> (L_M - Newmantissa);
-                    }
-                }
-            }
-        }
-        return FloatingPoint<Newexponent, Newmantissa>(new_sign, new_E_value, new_M_value);
-    }
-
-    /* Unary Operation */
-    FloatingPoint neg() const
-    {
-        return FloatingPoint(!sign, E_value, M_value);
-    }
-
-    FloatingPoint operator-() const
-    {
-        return neg();
-    }
-
-    friend FloatingPoint neg(const FloatingPoint &value)
-    {
-        return value.neg();
-    }
-
-    FloatingPoint abs() const
-    {
-        return FloatingPoint(false, E_value, M_value);
-    }
-
-    friend FloatingPoint abs(const FloatingPoint &value)
-    {
-        return value.abs();
-    }
-
-    FloatingPoint sqrt() const
-    {
-        if (sign == true)
-        {
-            std::cout << "Negative Input!!!" << std::endl;
-        }
-        else
-        {
-        }
-    }
-
-    FloatingPoint exp() const
-    {
-        if (mantissa + exponent > 32)
-        {
-            FloatingPoint<11, 52> Temp = this->template Trans_<11, 52>(exponent, mantissa, Bin(*this));
-            double ex = binary64_to_double(Bin(Temp));
-            ex = std::exp(ex);
-            return FloatingPoint(ex);
-        }
-        else
-        {
-            FloatingPoint<8, 23> Temp = this->template Trans_<8, 23>(exponent, mantissa, Bin(*this));
-            float ex = binary32_to_float(Bin(Temp));
-            std::cout << std::bitset<32>(Bin(Temp)) << std::endl;
-            ex = std::exp(ex);
-            return FloatingPoint(ex);
-        }
-    }
-    friend FloatingPoint exp(const FloatingPoint& fp) {
-        return fp.exp();
-    };
-
-    FloatingPoint relu() const
-    {
-        if (sign)
-        {
-            return createZero();
-        }
-        else
-        {
-            return (*this);
-        }
-    }
-    friend FloatingPoint relu(const FloatingPoint &fp)
-    {
-        return fp.relu();
-    }
-
-    // Addition
-    FloatingPoint add(const FloatingPoint &other) const
-    {
-        if (state == Nan)
-        {
-            return *this;
-        }
-        else if (other.state == Nan)
-        {
-            return other;
-        }
-
-        if (state == Inf)
-        {
-            if (other.state == Inf)
-            {
-                return (sign == other.sign) ? *this : createZero();
-            }
-            return *this;
-        }
-
-        if (other.state == Inf)
-        {
-            return other;
-        }
-
-        if (state == Zero || state == Subnormal)
-        {
-            return other;
-        }
-
-        if (other.state == Zero || state == Subnormal)
-        {
-            return *this;
-        }
-
-        // both normal case
-        bool sign1 = sign;
-        int64_t exp1 = static_cast<int64_t>(E_value) - (E_mask >> 1);
-        if (state == Subnormal)
-        {
-            exp1 += 1;
-        }
-        uint64_t mantissa1 = (state == Subnormal) ? M_value : M_value | (M_mask + 1);
-
-        bool sign2 = other.sign;
-        int64_t exp2 = static_cast<int64_t>(other.E_value) - (E_mask >> 1);
-        if (other.state == Subnormal)
-        {
-            exp2 += 1;
-        }
-        uint64_t mantissa2 = (other.state == Subnormal) ? other.M_value : other.M_value | (M_mask + 1);
-
-        // Align exponents by shifting the smaller number's mantissa right
-        int64_t exp_diff = exp1 - exp2;
-        if (exp_diff < 0)
-        {
-            std::swap(sign1, sign2);
-            std::swap(exp1, exp2);
-            std::swap(mantissa1, mantissa2);
-            exp_diff = -exp_diff;
-        }
-
-        if (exp_diff > static_cast<int64_t>(mantissa))
-        {
-            // The smaller number is too small to affect the larger one
-            return *this;
-        }
-
-        mantissa1 <<= exp_diff;
-
-        // Perform addition or subtraction based on signs
-        uint64_t result_mantissa;
-        bool result_sign;
-        if (sign1 == sign2)
-        {
-            result_sign = sign1;
-            result_mantissa = mantissa1 + mantissa2;
-        }
-        else
-        {
-            if (mantissa1 > mantissa2)
-            {
-                result_mantissa = mantissa1 - mantissa2;
-                result_sign = sign1;
-            }
-            else
-            {
-                result_mantissa = mantissa2 - mantissa1;
-                result_sign = sign2;
-            }
-        }
-
-        // Normalize the result
-        if (result_mantissa == 0)
-        {
-            return createZero();
-        }
-
-        if ((result_mantissa & ((1ULL << exp_diff) - 1)) > 0)
-        {
-            result_mantissa >>= exp_diff;
-            if (result_mantissa & 1 > 0)
-            {
-                result_mantissa += 1;
-            }
-        }
-        else
-        {
-            result_mantissa >>= exp_diff;
-        }
-
-        int first = findFirstOneBit(result_mantissa);
-
-        if (first >= mantissa)
-        {
-            exp1 += (first - mantissa);
-            if (exp1 >= E_mask)
-            {
-                exp1 = E_mask;
-                result_mantissa = 0;
-            }
-            else
-            {
-                result_mantissa &= ((1ULL << first) - 1);
-                if ((result_mantissa & ((1ULL << (first - mantissa)) - 1)) > 0)
-                {
-                    result_mantissa >>= (first - mantissa);
-                    result_mantissa += 1;
-                }
-                else
-                {
-                    result_mantissa >>= (first - mantissa);
-                }
-            }
-        }
-        else
-        {
-            if (exp1 + (E_mask >> 1) > (mantissa - first))
-            {
-                exp1 -= (mantissa - first);
-                result_mantissa <<= (mantissa - first);
-            }
-            else
-            {
-                result_mantissa <<= (exp1 + (E_mask >> 1));
-                exp1 = -(E_mask >> 1);
-            }
-        }
-
-        // Pack the result
-        FloatingPoint<exponent, mantissa> result;
-        result.sign = result_sign;
-        result.E_value = static_cast<uint64_t>(exp1 + (E_mask >> 1));
-        result.M_value = result_mantissa & (M_mask);
-        result.state = update_state(result);
-
-        return result;
-    }
-    friend FloatingPoint add(const FloatingPoint &fp1, const FloatingPoint &fp2)
-    {
-        return fp1.add(fp2);
-    }
-    FloatingPoint operator+(const FloatingPoint &other) const
-    {
-        return add(other);
-    };
-    friend FloatingPoint operator+(int val, const FloatingPoint &fp)
-    {
-        return FloatingPoint(val) + fp;
-    }
-    friend FloatingPoint operator+(const FloatingPoint &fp, int val)
-    {
-        return fp + FloatingPoint(val);
-    }
-    friend FloatingPoint operator+(double val, const FloatingPoint &fp)
-    {
-        return FloatingPoint(val) + fp;
-    }
-    friend FloatingPoint operator+(const FloatingPoint &fp, double val)
-    {
-        return fp + FloatingPoint(val);
-    }
-    FloatingPoint operator+=(const FloatingPoint &other)
-    {
-        *this = add(other);
-        return *this;
-    }
-    FloatingPoint operator+=(int val)
-    {
-        *this = add(FloatingPoint(val));
-        return *this;
-    }
-    FloatingPoint operator+=(double val)
-    {
-        *this = add(FloatingPoint(val));
-        return *this;
-    }
-
-    // Subtraction
-    FloatingPoint sub(const FloatingPoint &other) const
-    {
-        return add(other.neg());
-    }
-    friend FloatingPoint sub(const FloatingPoint &fp1, const FloatingPoint &fp2)
-    {
-        return fp1.sub(fp2);
-    }
-    FloatingPoint operator-(const FloatingPoint &other) const
-    {
-        return sub(other);
-    };
-    friend FloatingPoint operator-(int val, const FloatingPoint &fp)
-    {
-        return FloatingPoint(val) - fp;
-    }
-    friend FloatingPoint operator-(const FloatingPoint &fp, int val)
-    {
-        return fp - FloatingPoint(val);
-    }
-    friend FloatingPoint operator-(double val, const FloatingPoint &fp)
-    {
-        return FloatingPoint(val) - fp;
-    }
-    friend FloatingPoint operator-(const FloatingPoint &fp, double val)
-    {
-        return fp - FloatingPoint(val);
-    }
-    FloatingPoint operator-=(const FloatingPoint &other)
-    {
-        *this = sub(other);
-        return *this;
-    }
-    FloatingPoint operator-=(int val)
-    {
-        *this = sub(FloatingPoint(val));
-        return *this;
-    }
-    FloatingPoint operator-=(double val)
-    {
-        *this = sub(FloatingPoint(val));
-        return *this;
-    }
-
-    // Multiplication
-    FloatingPoint mul(const FloatingPoint &other) const
-    {
-        if (state == Nan)
-        {
-            return *this;
-        }
-        if (other.state == Nan)
-        {
-            return other;
-        }
-
-        if (state == Zero)
-        {
-            bool result_sign = sign ^ other.sign;
-            return (result_sign == sign) ? *this : (*this).neg();
-        }
-        if (other.state == Zero)
-        {
-            bool result_sign = sign ^ other.sign;
-            return (result_sign == other.sign) ? other : other.neg();
-        }
-
-        if (state == Inf)
-        {
-            bool result_sign = sign ^ other.sign;
-            return (result_sign == sign) ? *this : (*this).neg();
-        }
-        if (other.state == Inf)
-        {
-            bool result_sign = sign ^ other.sign;
-            return (result_sign == other.sign) ? other : other.neg();
-        }
-
-        // Normal and Subnormal
-        bool sign1 = sign;
-        int64_t exp1 = static_cast<int64_t>(E_value) - (E_mask >> 1);
-        if (state == Subnormal)
-        {
-            exp1 += 1;
-        }
-        uint64_t mantissa1 = (state == Subnormal) ? M_value : (M_value | (M_mask + 1));
-
-        bool sign2 = other.sign;
-        int64_t exp2 = static_cast<int64_t>(other.E_value) - (E_mask >> 1);
-        if (other.state == Subnormal)
-        {
-            exp2 += 1;
-        }
-        uint64_t mantissa2 = (other.state == Subnormal) ? other.M_value : (other.M_value | (M_mask + 1));
-        
-        // Calculate result sign (XOR of input signs)
-        bool result_sign = sign1 ^ sign2;
-
-        int64_t result_exp = exp1 + exp2;
-
-        uint64_t a_low = mantissa1 & 0xFFFFFFFF;
-        uint64_t a_high = mantissa1 >> 32;
-        uint64_t b_low = mantissa2 & 0xFFFFFFFF;
-        uint64_t b_high = mantissa2 >> 32;
-
-        uint64_t p0 = a_low * b_low;
-        uint64_t p1 = a_low * b_high;
-        uint64_t p2 = a_high * b_low;
-        uint64_t p3 = a_high * b_high;
-        
-        uint64_t low0 = (p0 & 0xFFFFFFFF);
-        uint64_t low1 = (p2 & 0xFFFFFFFF) + (p1 & 0xFFFFFFFF) + (p0 >> 32);
-        uint64_t high0 = (p3 & 0xFFFFFFFF) + (p2 >> 32) + (p1 >> 32) + (low1 >> 32);
-        low1 &= 0xFFFFFFFF;
-        uint64_t high1 = (p3 >> 32) + (high0 >> 32);
-        high0 &= 0xFFFFFFFF;
-        
-        uint64_t result_mantissa;
-        if (mantissa <= 32)
-        {
-            result_mantissa = (high0 << (64 - mantissa)) | (low1 << (32 - mantissa)) | (low0 >> mantissa);
-        }
-        else
-        {
-            result_mantissa = (high1 << (96 - mantissa)) | (high0 << (64 - mantissa)) | (low1 >> (mantissa - 32));
-        }
-
-        if (((low0 | (low1 << 32)) & M_mask) > 0)
-        {
-            result_mantissa += 1;
-        }
-
-        if ((result_mantissa & ((M_mask + 1) << 1)) > 0)
-        {
-            result_exp += 1;
-            int last = result_mantissa & 0b1;
-            result_mantissa >>= 1;
-            if ((last > 0) && (result_mantissa & 0b1 > 0))
-            {
-                result_mantissa += 1;
-            }
-        }
-        else
-        {
-            if ((result_exp + (E_mask >> 1)) < 0)
-            {
-                return createZero();
-            }
-            
-            int first = findFirstOneBit(result_mantissa);
-            if (first < mantissa)
-            {
-                uint64_t e = result_exp + (E_mask >> 1);
-                
-                if (e > mantissa - first)
-                {
-                    result_exp -= (mantissa - first);
-                }
-                else
-                {
-                    result_exp = -(E_mask >> 1);
-                    result_mantissa <<= e;
-                }
-            }
-        }
-
-        if (result_exp + (E_mask >> 1) < 0)
-        {
-            return createZero();
-        }
-        if (result_exp + (E_mask >> 1) >= E_mask)
-        {
-            return createInfinity(result_sign);
-        }
-        
-        // Pack the result
-        FloatingPoint<exponent, mantissa> result;
-        result.sign = result_sign;
-        result.E_value = static_cast<uint64_t>(result_exp + (E_mask >> 1));
-        result.M_value = result_mantissa & (M_mask);
-        result.state = update_state(result);
-
-        return result;
-    }
-    friend FloatingPoint mul(const FloatingPoint &fp1, const FloatingPoint &fp2)
-    {
-        return fp1.mul(fp2);
-    }
-    FloatingPoint operator*(const FloatingPoint &other) const
-    {
-        return mul(other);
-    };
-    friend FloatingPoint operator*(int val, const FloatingPoint &fp)
-    {
-        return FloatingPoint(val) * fp;
-    }
-    friend FloatingPoint operator*(double val, const FloatingPoint &fp)
-    {
-        return FloatingPoint(val) * fp;
-    }
-    friend FloatingPoint operator*(const FloatingPoint &fp, int val)
-    {
-        return fp * FloatingPoint(val);
-    }
-    friend FloatingPoint operator*(const FloatingPoint &fp, double val)
-    {
-        return fp * FloatingPoint(val);
-    }
-    FloatingPoint operator*=(const FloatingPoint &other)
-    {
-        *this = mul(other);
-        return *this;
-    }
-    FloatingPoint operator*=(int val)
-    {
-        *this = mul(val);
-        return *this;
-    }
-    FloatingPoint operator*=(double val)
-    {
-        *this = mul(val);
-        return *this;
-    }
-
-    // Comparison Operator
-    bool operator==(const FloatingPoint &other) const
-    {
-        if ((state == Nan) || (other.state == Nan))
-        {
-            std::cout << "The input of compare function can not be NAN !!!" << std::endl;
-            return 0;
-        }
-        return sign == other.sign && E_value == other.E_value && M_value == other.M_value;
-    };
-    bool operator!=(const FloatingPoint &other) const
-    {
-        return !(*this == other);
-    };
-    bool operator<(const FloatingPoint &other) const
-    {
-        if ((state == Nan) || (other.state == Nan))
-        {
-            std::cout << "The input of compare function can not be NAN !!!" << std::endl;
-            return 0;
-        }
-        if (sign != other.sign)
-        {
-            return sign;
-        }
-        else if (E_value != other.E_value)
-        {
-            return sign ? E_value > other.E_value : E_value < other.E_value;
-        }
-        else
-        {
-            return sign ? M_value > other.M_value : M_value < other.M_value;
-        }
-    };
-    bool operator<=(const FloatingPoint &other) const
-    {
-        return *this < other || *this == other;
-    };
-    bool operator>(const FloatingPoint &other) const
-    {
-        return !(*this <= other);
-    };
-    bool operator>=(const FloatingPoint &other) const
-    {
-        return !(*this < other);
-    };
-};
-
+#ifndef FLOATINGPOINT_HPP_
+#define FLOATINGPOINT_HPP_
+
+// Requires C++20 (std::bit_cast and std::is_constant_evaluated, for the constexpr core)
+// and a compiler with unsigned __int128, such as GCC or Clang
+#if __cplusplus < 202002L
+#error "FloatingPoint_1.hpp requires C++20: compile with -std=c++20"
+#endif
+
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <iostream>
+#include <cmath>
+#include <iomanip>
+#include <bitset>
+#include <cstring>
+#include <type_traits>
+#include <algorithm>
+#include <array>
+#include <utility>
+#if defined(FLOATINGPOINT_PROFILE)
+#include <atomic>
+#include <mutex>
+#include <vector>
+#endif
+
+typedef enum STATE
+{
+    Normal,
+    Subnormal,
+    Zero,
+    Inf,
+    Nan
+} State;
+
+// IEEE rounding directions, plus stochastic rounding. Operations take the mode as a
+// template argument defaulting to RoundNearestEven, so the choice costs nothing.
+typedef enum ROUNDING
+{
+    RoundNearestEven,
+    RoundTowardZero,
+    RoundUpward,
+    RoundDownward,
+    RoundNearestAway,
+    RoundStochastic
+} Rounding;
+
+// IEEE exception flags. Operations never print; they raise flags in a sticky word of the
+// calling thread, to be read with test_flags() after a computation and reset with
+// clear_flags(). Underflow is signalled for inexact results that are tiny before
+// rounding.
+typedef enum FLAG
+{
+    FlagInvalid = 1,
+    FlagDivideByZero = 2,
+    FlagOverflow = 4,
+    FlagUnderflow = 8,
+    FlagInexact = 16,
+    FlagAll = 31
+} Flag;
+
+inline unsigned &thread_flags()
+{
+    thread_local unsigned flags = 0;
+    return flags;
+}
+
+// Constant evaluation has no thread to raise flags on, so there they are dropped
+constexpr void raise_flags(unsigned flags)
+{
+    if (!std::is_constant_evaluated())
+        thread_flags() |= flags;
+}
+
+inline unsigned test_flags(unsigned mask = FlagAll)
+{
+    return thread_flags() & mask;
+}
+
+inline void clear_flags(unsigned mask = FlagAll)
+{
+    thread_flags() &= ~mask;
+}
+
+// Numerical profiling. Built with FLOATINGPOINT_PROFILE defined, add, mul, div, sqrt,
+// fma and every format conversion (constructors, assignments, to<>()) count per thread
+// how often they ran and which flags they raised, plus how many results underflowed all
+// the way to zero. profile_histogram() merges the counters of all threads, live and
+// finished. Without the switch the operations carry no instrumentation and the
+// histogram stays empty.
+typedef enum PROFILE_OP
+{
+    ProfileAdd,
+    ProfileMul,
+    ProfileDiv,
+    ProfileSqrt,
+    ProfileFma,
+    ProfileConvert,
+    ProfileOpCount
+} ProfileOp;
+
+typedef enum PROFILE_EVENT
+{
+    EventCalls,
+    EventInvalid,
+    EventDivideByZero,
+    EventOverflow,
+    EventUnderflow,
+    EventInexact,
+    EventFlushToZero,
+    EventCount
+} ProfileEvent;
+
+struct ProfileHistogram
+{
+    uint64_t counts[ProfileOpCount][EventCount] = {};
+
+    void print(std::ostream &out = std::cout) const
+    {
+        static const char *ops[ProfileOpCount] = {"add", "mul", "div", "sqrt", "fma", "convert"};
+        out << std::left << std::setw(10) << "op" << std::setw(14) << "calls" << std::setw(14) << "invalid"
+            << std::setw(14) << "div-by-zero" << std::setw(14) << "overflow" << std::setw(14) << "underflow"
+            << std::setw(14) << "inexact" << "flush-to-zero\n";
+        for (int op = 0; op < ProfileOpCount; ++op)
+        {
+            out << std::setw(10) << ops[op];
+            for (int event = 0; event + 1 < EventCount; ++event)
+                out << std::setw(14) << counts[op][event];
+            out << counts[op][EventCount - 1] << "\n";
+        }
+    }
+};
+
+#if defined(FLOATINGPOINT_PROFILE)
+namespace profile_detail
+{
+    // Set beside the IEEE flags by round_pack() when a result underflows to zero
+    constexpr unsigned FlagFlushToZero = 32;
+
+    // Only the owning thread writes its counters; the relaxed atomics let another
+    // thread merge them at any time without a locked increment on the hot path
+    struct Counters
+    {
+        std::atomic<uint64_t> counts[ProfileOpCount][EventCount] = {};
+    };
+
+    struct Registry
+    {
+        std::mutex lock;
+        std::vector<Counters *> live;
+        ProfileHistogram retired;
+    };
+
+    inline Registry &registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    // Joins the registry on first use and folds its counts into retired on thread exit
+    struct ThreadCounters : Counters
+    {
+        ThreadCounters()
+        {
+            std::lock_guard<std::mutex> guard(registry().lock);
+            registry().live.push_back(this);
+        }
+        ~ThreadCounters()
+        {
+            Registry &shared = registry();
+            std::lock_guard<std::mutex> guard(shared.lock);
+            for (int op = 0; op < ProfileOpCount; ++op)
+                for (int event = 0; event < EventCount; ++event)
+                    shared.retired.counts[op][event] += counts[op][event].load(std::memory_order_relaxed);
+            shared.live.erase(std::find(shared.live.begin(), shared.live.end(), this));
+        }
+    };
+
+    inline Counters &thread_counters()
+    {
+        thread_local ThreadCounters counters;
+        return counters;
+    }
+
+    inline void count(std::atomic<uint64_t> &counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Counts one operation: starts it with clear flags and, when it returns, records
+    // what it raised and puts the caller's flags back on top; constant evaluation is
+    // not counted
+    template <ProfileOp op>
+    class Scope
+    {
+    public:
+        constexpr Scope()
+        {
+            if (!std::is_constant_evaluated())
+            {
+                saved = thread_flags();
+                thread_flags() = 0;
+            }
+        }
+        constexpr ~Scope()
+        {
+            if (std::is_constant_evaluated())
+                return;
+            const unsigned raised = thread_flags();
+            std::atomic<uint64_t> *counts = thread_counters().counts[op];
+            count(counts[EventCalls]);
+            if (raised & FlagInvalid)
+                count(counts[EventInvalid]);
+            if (raised & FlagDivideByZero)
+                count(counts[EventDivideByZero]);
+            if (raised & FlagOverflow)
+                count(counts[EventOverflow]);
+            if (raised & FlagUnderflow)
+                count(counts[EventUnderflow]);
+            if (raised & FlagInexact)
+                count(counts[EventInexact]);
+            if (raised & FlagFlushToZero)
+                count(counts[EventFlushToZero]);
+            thread_flags() = saved | (raised & FlagAll);
+        }
+
+    private:
+        unsigned saved = 0;
+    };
+}
+
+#define FLOATINGPOINT_PROFILE_SCOPE(op) profile_detail::Scope<op> profile_scope_
+
+inline ProfileHistogram profile_histogram()
+{
+    profile_detail::Registry &shared = profile_detail::registry();
+    std::lock_guard<std::mutex> guard(shared.lock);
+    ProfileHistogram total = shared.retired;
+    for (const profile_detail::Counters *counters : shared.live)
+        for (int op = 0; op < ProfileOpCount; ++op)
+            for (int event = 0; event < EventCount; ++event)
+                total.counts[op][event] += counters->counts[op][event].load(std::memory_order_relaxed);
+    return total;
+}
+
+// Counts a thread adds while the reset runs may survive it
+inline void profile_reset()
+{
+    profile_detail::Registry &shared = profile_detail::registry();
+    std::lock_guard<std::mutex> guard(shared.lock);
+    shared.retired = ProfileHistogram();
+    for (profile_detail::Counters *counters : shared.live)
+        for (int op = 0; op < ProfileOpCount; ++op)
+            for (int event = 0; event < EventCount; ++event)
+                counters->counts[op][event].store(0, std::memory_order_relaxed);
+}
+#else
+#define FLOATINGPOINT_PROFILE_SCOPE(op)
+
+inline ProfileHistogram profile_histogram() { return ProfileHistogram(); }
+inline void profile_reset() {}
+#endif
+
+// 找到左数第一个一
+constexpr int findFirstOneBit(uint64_t bin_value)
+{
+    if (bin_value == 0)
+        return 0;
+    return 63 - __builtin_clzll(bin_value);
+}
+
+constexpr int findFirstOneBit128(unsigned __int128 bin_value)
+{
+    const uint64_t high = static_cast<uint64_t>(bin_value >> 64);
+    return high != 0 ? 64 + findFirstOneBit(high) : findFirstOneBit(static_cast<uint64_t>(bin_value));
+}
+
+// Full 128-bit product of two 64-bit significands from 32x32-bit partial products;
+// returns the low half and leaves the high half in high
+constexpr uint64_t multiply_wide(uint64_t a, uint64_t b, uint64_t &high)
+{
+    uint64_t a_low = a & 0xFFFFFFFF;
+    uint64_t a_high = a >> 32;
+    uint64_t b_low = b & 0xFFFFFFFF;
+    uint64_t b_high = b >> 32;
+
+    uint64_t p0 = a_low * b_low;
+    uint64_t p1 = a_low * b_high;
+    uint64_t p2 = a_high * b_low;
+    uint64_t p3 = a_high * b_high;
+
+    uint64_t low0 = (p0 & 0xFFFFFFFF);
+    uint64_t low1 = (p2 & 0xFFFFFFFF) + (p1 & 0xFFFFFFFF) + (p0 >> 32);
+    uint64_t high0 = (p3 & 0xFFFFFFFF) + (p2 >> 32) + (p1 >> 32) + (low1 >> 32);
+    low1 &= 0xFFFFFFFF;
+    uint64_t high1 = (p3 >> 32) + (high0 >> 32);
+    high0 &= 0xFFFFFFFF;
+
+    high = (high1 << 32) | high0;
+    return (low1 << 32) | low0;
+}
+
+// 1,8,23表示的floatingpoint转换为float
+constexpr float binary32_to_float(uint32_t binary)
+{
+    return std::bit_cast<float>(binary);
+}
+
+// 1,11,52表示的floatingpoint转换为double
+constexpr double binary64_to_double(uint64_t binary)
+{
+    return std::bit_cast<double>(binary);
+}
+
+// Random bits for RoundStochastic come from a counter-based generator: draw number
+// `counter` of stream `key` is a hash of the pair, so any draw can be reproduced without
+// replaying the ones before it. Each thread has its own key and counter; every inexact
+// stochastic rounding takes one draw and advances the counter.
+inline uint64_t stochastic_hash(uint64_t key, uint64_t counter)
+{
+    // splitmix64 finalizer over a Weyl sequence
+    uint64_t z = key + (counter + 1) * 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+struct StochasticState
+{
+    uint64_t key = 0;
+    uint64_t counter = 0;
+};
+
+inline StochasticState &stochastic_state()
+{
+    thread_local StochasticState state;
+    return state;
+}
+
+// Select the stream for the calling thread, e.g. seed per run and stream per batch,
+// starting at draw `counter`
+inline void stochastic_seed(uint64_t seed, uint64_t stream = 0, uint64_t counter = 0)
+{
+    StochasticState &state = stochastic_state();
+    state.key = stochastic_hash(seed, stream);
+    state.counter = counter;
+}
+
+inline uint64_t stochastic_bits()
+{
+    StochasticState &state = stochastic_state();
+    return stochastic_hash(state.key, state.counter++);
+}
+
+// Whether an inexact result whose magnitude was truncated to result rounds away from
+// zero. frac holds the dropped bits left-aligned at bit 63, sticky marks anything
+// dropped below those.
+template <Rounding mode>
+constexpr bool round_up(bool sign, uint64_t result, uint64_t frac, bool sticky)
+{
+    const bool half = frac >> 63;
+    const bool rest = (frac << 1) != 0 || sticky;
+
+    if constexpr (mode == RoundNearestEven)
+        return half && (rest || (result & 1));
+    else if constexpr (mode == RoundNearestAway)
+        return half;
+    else if constexpr (mode == RoundTowardZero)
+        return false;
+    else if constexpr (mode == RoundUpward)
+        return !sign && (half || rest);
+    else if constexpr (mode == RoundDownward)
+        return sign && (half || rest);
+    else
+    { // away from zero with probability equal to the dropped fraction of an ulp
+        if (frac == 0 && !sticky)
+            return false;
+        const uint64_t random = stochastic_bits();
+        return frac > random || (frac == random && sticky);
+    }
+}
+
+// Whether a result too large for the format becomes infinity rather than the largest
+// finite value
+template <Rounding mode>
+constexpr bool overflow_to_infinity(bool sign)
+{
+    if constexpr (mode == RoundTowardZero)
+        return false;
+    else if constexpr (mode == RoundUpward)
+        return !sign;
+    else if constexpr (mode == RoundDownward)
+        return sign;
+    else
+        return true;
+}
+
+// Special values of a format. IEEE reserves the all-ones exponent for infinities (zero
+// mantissa) and NaNs. FP8 E4M3 keeps that exponent for finite values except the
+// all-ones encoding, its only NaN, and has no infinity; the MX FP6 and FP4 element
+// formats spend every encoding on finite values.
+typedef enum SPECIALS
+{
+    SpecialsIEEE,
+    SpecialsNanOnly,
+    SpecialsNone
+} Specials;
+
+// What a format fixes besides its field widths: the exponent bias as an offset from
+// IEEE's 2^(exponent - 1) - 1, the special values, and whether a result too large for
+// the format saturates at the largest finite value instead of becoming infinity, or NaN
+// when there is no infinity. Formats with neither always saturate.
+template <int bias_offset = 0, Specials specials = SpecialsIEEE, bool saturate = false>
+struct FloatingPointTraits
+{
+    static constexpr int bias_adjust = bias_offset;
+    static constexpr Specials special_values = specials;
+    static constexpr bool saturating = saturate || specials == SpecialsNone;
+};
+
+using IEEETraits = FloatingPointTraits<>;
+
+// Encoding constants of <exponent, mantissa> under Traits. Magnitudes are encodings
+// with the sign bit cleared.
+template <int exponent, int mantissa, class Traits>
+struct FloatingPointEncoding
+{
+    static constexpr uint64_t E_mask = (1ULL << exponent) - 1;
+    static constexpr uint64_t M_mask = (1ULL << mantissa) - 1;
+    static constexpr uint64_t magnitude_mask = (E_mask << mantissa) | M_mask;
+    static constexpr int64_t bias = static_cast<int64_t>(E_mask >> 1) + Traits::bias_adjust;
+
+    // IEEE layout: converting between two such formats only moves fields when widening
+    static constexpr bool ieee = Traits::special_values == SpecialsIEEE && Traits::bias_adjust == 0;
+    static constexpr bool has_infinity = Traits::special_values == SpecialsIEEE;
+    static constexpr bool has_nan = Traits::special_values != SpecialsNone;
+
+    static constexpr uint64_t infinity = E_mask << mantissa;
+    static constexpr uint64_t max_finite = Traits::special_values == SpecialsIEEE      ? infinity - 1
+                                           : Traits::special_values == SpecialsNanOnly ? magnitude_mask - 1
+                                                                                       : magnitude_mask;
+    // quiet NaN produced by invalid operations; formats without NaN produce zero
+    static constexpr uint64_t quiet_nan = Traits::special_values == SpecialsIEEE      ? infinity | ((M_mask >> 1) + 1)
+                                          : Traits::special_values == SpecialsNanOnly ? magnitude_mask
+                                                                                      : 0;
+    // unbiased exponent of the leading one of the largest finite value
+    static constexpr int64_t E_max = static_cast<int64_t>(max_finite >> mantissa) - bias;
+
+    static constexpr bool is_nan(uint64_t magnitude)
+    {
+        if constexpr (Traits::special_values == SpecialsIEEE)
+            return magnitude > infinity;
+        else
+            return Traits::special_values == SpecialsNanOnly && magnitude == magnitude_mask;
+    }
+
+    static constexpr bool is_infinity(uint64_t magnitude) { return has_infinity && magnitude == infinity; }
+
+    // Magnitude of a result too large for the format
+    template <Rounding mode>
+    static constexpr uint64_t overflow(bool sign)
+    {
+        if (Traits::saturating || !overflow_to_infinity<mode>(sign))
+        {
+            return max_finite;
+        }
+        return has_infinity ? infinity : quiet_nan;
+    }
+};
+
+// Round sig * 2^exp to the precision of <exponent, mantissa>: returns the rounded
+// significand and moves exp to the exponent of its lowest bit. Values below the normal
+// range keep the subnormal spacing and may round to 0; a carry may leave the result at
+// 2^(mantissa + 1). sticky marks non-zero bits the caller already dropped below sig.
+// sig must not be 0.
+template <int exponent, int mantissa, Rounding mode = RoundNearestEven, class Traits = IEEETraits>
+constexpr uint64_t round_significand(bool sign, int64_t &exp, uint64_t sig, bool sticky = false)
+{
+    constexpr int64_t bias = FloatingPointEncoding<exponent, mantissa, Traits>::bias;
+    constexpr int64_t E_min = 1 - bias;
+
+    // unbiased exponent of the leading one
+    int64_t E_lead = exp + findFirstOneBit(sig);
+    int64_t shift = std::max(E_lead, E_min) - mantissa - exp;
+    uint64_t result, frac;
+    if (shift <= 0)
+    {
+        result = sig << -shift;
+        frac = 0;
+    }
+    else if (shift < 64)
+    {
+        result = sig >> shift;
+        frac = sig << (64 - shift);
+    }
+    else
+    {
+        result = 0;
+        frac = (shift - 64 < 64) ? sig >> (shift - 64) : 0;
+        sticky = sticky || (shift - 64 >= 64) || (sig & ((1ULL << (shift - 64)) - 1)) != 0;
+    }
+    exp += shift;
+    if (frac == 0 && !sticky)
+    {
+        return result;
+    }
+    raise_flags(E_lead < E_min ? FlagInexact | FlagUnderflow : FlagInexact);
+    return result + round_up<mode>(sign, result, frac, sticky);
+}
+
+// Round sig * 2^exp to a <exponent, mantissa> encoding; sticky marks non-zero bits the
+// caller already dropped below sig. sig must not be 0.
+template <int exponent, int mantissa, Rounding mode = RoundNearestEven, class Traits = IEEETraits>
+constexpr uint64_t round_pack(bool sign, int64_t exp, uint64_t sig, bool sticky = false)
+{
+    using Encoding = FloatingPointEncoding<exponent, mantissa, Traits>;
+    constexpr int64_t bias = Encoding::bias;
+    const uint64_t sign_bit = static_cast<uint64_t>(sign) << (exponent + mantissa);
+
+    if (exp + findFirstOneBit(sig) > Encoding::E_max)
+    { // infinity, or the largest finite value when rounding toward zero or saturating
+        raise_flags(FlagOverflow | FlagInexact);
+        return sign_bit | Encoding::template overflow<mode>(sign);
+    }
+
+    // exp comes back as E_min - mantissa for subnormals. The exponent is added rather
+    // than or-ed in so that a carry out of the mantissa bumps it (subnormal -> normal);
+    // a carry past the largest finite value overflows
+    uint64_t result = round_significand<exponent, mantissa, mode, Traits>(sign, exp, sig, sticky);
+#if defined(FLOATINGPOINT_PROFILE)
+    if (result == 0)
+        raise_flags(profile_detail::FlagFlushToZero);
+#endif
+    uint64_t E_base = static_cast<uint64_t>(exp + mantissa + bias - 1);
+    const uint64_t magnitude = (E_base << mantissa) + result;
+    if (magnitude > Encoding::max_finite)
+    { // a rounding carry, or E4M3's NaN pattern reached exactly
+        raise_flags(FlagOverflow | FlagInexact);
+        return sign_bit | Encoding::template overflow<mode>(sign);
+    }
+    return sign_bit | magnitude;
+}
+
+// Exact sum of two non-zero signed values, a 128-bit product * 2^product_exp and
+// addend * 2^addend_exp, folded into a 64-bit significand. Returns it with sign and exp
+// set and sticky marking non-zero bits folded away, or 0 when the two cancel exactly.
+constexpr uint64_t fused_sum(bool &sign, int64_t &exp, bool &sticky,
+                          bool product_sign, int64_t product_exp, unsigned __int128 product,
+                          bool addend_sign, int64_t addend_exp, uint64_t addend)
+{
+    auto lead = [](unsigned __int128 value)
+    {
+        uint64_t high = static_cast<uint64_t>(value >> 64);
+        return high != 0 ? 64 + findFirstOneBit(high) : findFirstOneBit(static_cast<uint64_t>(value));
+    };
+
+    // Leading ones at bit 125: the sum cannot carry out of the word and, as in add(),
+    // only an operand shifted by two or more bits loses anything
+    int product_shift = 125 - lead(product);
+    product <<= product_shift;
+    product_exp -= product_shift;
+    int addend_shift = 125 - findFirstOneBit(addend);
+    unsigned __int128 other = static_cast<unsigned __int128>(addend) << addend_shift;
+    addend_exp -= addend_shift;
+
+    if (addend_exp > product_exp || (addend_exp == product_exp && other > product))
+    {
+        std::swap(product, other);
+        std::swap(product_exp, addend_exp);
+        std::swap(product_sign, addend_sign);
+    }
+
+    // Align the smaller one, jamming what is shifted out into its lowest bit
+    int64_t exp_diff = product_exp - addend_exp;
+    bool jam = false;
+    if (exp_diff >= 128)
+    {
+        jam = true;
+        other = 0;
+    }
+    else if (exp_diff > 0)
+    {
+        jam = (other << (128 - exp_diff)) != 0;
+        other >>= exp_diff;
+    }
+    other |= jam;
+
+    unsigned __int128 sum = (product_sign == addend_sign) ? product + other : product - other;
+    if (sum == 0)
+    {
+        return 0;
+    }
+
+    sign = product_sign;
+    int drop = std::max(lead(sum) - 63, 0);
+    sticky = (sum & ((static_cast<unsigned __int128>(1) << drop) - 1)) != 0;
+    exp = product_exp + drop;
+    return static_cast<uint64_t>(sum >> drop);
+}
+
+// High half of the 128-bit product of two 64-bit words
+constexpr uint64_t multiply_high(uint64_t a, uint64_t b)
+{
+    return static_cast<uint64_t>((static_cast<unsigned __int128>(a) * b) >> 64);
+}
+
+// 2^x for x in fixed point with 64 fraction bits: returns the significand with its
+// leading one at bit 63 and sets exp to the exponent of its lowest bit. The error is
+// below 2^-60 of the result. 2^f = 2^(j / 64) * e^(r ln2), with j the top six bits of
+// the fraction f and r the rest.
+inline uint64_t exp2_fixed(__int128 x, int64_t &exp)
+{
+    // 2^(j / 64) with the leading one at bit 63, from the Taylor series of
+    // e^(j ln2 / 64) summed with 124 fraction bits
+    static constexpr std::array<uint64_t, 64> powers = []
+    {
+        using u128 = unsigned __int128;
+        constexpr u128 ln2 = (static_cast<u128>(0xB17217F7D1CF79ABULL) << 64) | 0xC9E3B39803F2F6AFULL;
+        auto multiply = [](u128 a, u128 b) // (a * b) >> 128
+        {
+            const u128 a_low = static_cast<uint64_t>(a), a_high = a >> 64;
+            const u128 b_low = static_cast<uint64_t>(b), b_high = b >> 64;
+            const u128 middle = ((a_low * b_low) >> 64) + static_cast<uint64_t>(a_high * b_low) +
+                                static_cast<uint64_t>(a_low * b_high);
+            return a_high * b_high + ((a_high * b_low) >> 64) + ((a_low * b_high) >> 64) + (middle >> 64);
+        };
+        std::array<uint64_t, 64> table{};
+        for (int j = 0; j < 64; ++j)
+        {
+            const u128 t = ln2 / 64 * j;
+            u128 term = static_cast<u128>(1) << 124;
+            u128 sum = term;
+            for (int i = 1; term != 0; ++i)
+            {
+                term = multiply(term, t) / i;
+                sum += term;
+            }
+            table[j] = static_cast<uint64_t>((sum + (static_cast<u128>(1) << 60)) >> 61);
+        }
+        return table;
+    }();
+    // 1 / i! with 64 fraction bits
+    static constexpr std::array<uint64_t, 8> inverse_factorials = []
+    {
+        std::array<uint64_t, 8> table{};
+        uint64_t factorial = 1;
+        for (int i = 2; i < 8; ++i)
+        {
+            factorial *= i;
+            table[i] = static_cast<uint64_t>((static_cast<unsigned __int128>(1) << 64) / factorial);
+        }
+        return table;
+    }();
+
+    const uint64_t f = static_cast<uint64_t>(x);
+    const uint64_t j = f >> 58;
+    const uint64_t t = multiply_high(f & ((1ULL << 58) - 1), 0xB17217F7D1CF79ABULL);
+
+    // e^t - 1 = t + t^2 (1/2! + t/3! + ... + t^5/7!); t < 2^-6 leaves the rest below 2^-67
+    uint64_t p = inverse_factorials[7];
+    for (int i = 6; i >= 2; --i)
+    {
+        p = inverse_factorials[i] + multiply_high(p, t);
+    }
+    const uint64_t q = t + multiply_high(multiply_high(p, t), t);
+
+    exp = static_cast<int64_t>(x >> 64) - 63;
+    return powers[j] + multiply_high(powers[j], q);
+}
+
+// ln m' for a significand sig with its leading one at bit 63, m = sig * 2^-63 in [1, 2):
+// m' is m, or m / 2 with k incremented when m >= sqrt(2), so that ln(m * 2^k) =
+// k ln2 + ln m'. Returns |ln m'| with its leading one at bit 63, sets sign and exp, and
+// returns 0 when m' = 1. The error is below 2^-60 of the result.
+inline uint64_t log_fixed(uint64_t sig, int64_t &k, bool &sign, int64_t &exp)
+{
+    // 1 / (2n + 1) with 64 fraction bits
+    static constexpr std::array<uint64_t, 13> inverse_odds = []
+    {
+        std::array<uint64_t, 13> table{};
+        for (int n = 1; n < 13; ++n)
+        {
+            table[n] = static_cast<uint64_t>((static_cast<unsigned __int128>(1) << 64) / (2 * n + 1));
+        }
+        return table;
+    }();
+
+    // m' with 62 fraction bits
+    uint64_t m = sig >> 1;
+    if (sig >= 0xB504F333F9DE6484ULL)
+    {
+        m = sig >> 2;
+        ++k;
+    }
+    const int64_t numerator = static_cast<int64_t>(m) - (1LL << 62);
+    if (numerator == 0)
+    {
+        return 0;
+    }
+    sign = numerator < 0;
+
+    // u = (m' - 1) / (m' + 1), |u| <= 3 - 2 sqrt(2), to 64 bits
+    const uint64_t magnitude = static_cast<uint64_t>(sign ? -numerator : numerator);
+    const int lz = 63 - findFirstOneBit(magnitude);
+    unsigned __int128 quotient = (static_cast<unsigned __int128>(magnitude << lz) << 64) / (m + (1ULL << 62));
+    const int lead = findFirstOneBit128(quotient);
+    const uint64_t u = static_cast<uint64_t>(quotient >> (lead - 63));
+    const int64_t u_exp = lead - 63 - 64 - lz;
+
+    // ln m' = 2 atanh(u) = 2u (1 + w/3 + w^2/5 + ... + w^12/25), w = u^2 < 2^-5
+    const int64_t w_shift = -(2 * u_exp + 128);
+    const uint64_t w = (w_shift < 64) ? multiply_high(u, u) >> w_shift : 0;
+    uint64_t p = inverse_odds[12];
+    for (int n = 11; n >= 1; --n)
+    {
+        p = inverse_odds[n] + multiply_high(p, w);
+    }
+    const uint64_t series = (1ULL << 63) + (multiply_high(p, w) >> 1);
+
+    uint64_t result = multiply_high(u, series);
+    exp = u_exp + 2;
+    if ((result >> 63) == 0)
+    {
+        result <<= 1;
+        --exp;
+    }
+    return result;
+}
+
+// Convert a <SrcE, SrcM> encoding to <DstE, DstM>. The widths and traits are template
+// constants, so the widening/narrowing choice is made at compile time. An infinity
+// overflows a format without one, and a NaN converted to a format without NaN is
+// invalid and gives zero.
+template <int SrcE, int SrcM, int DstE, int DstM, Rounding mode = RoundNearestEven,
+          class SrcTraits = IEEETraits, class DstTraits = IEEETraits>
+constexpr uint64_t convert(uint64_t bin_value)
+{
+    using Src = FloatingPointEncoding<SrcE, SrcM, SrcTraits>;
+    using Dst = FloatingPointEncoding<DstE, DstM, DstTraits>;
+    constexpr uint64_t Src_E_mask = Src::E_mask;
+    constexpr uint64_t Src_M_mask = Src::M_mask;
+    constexpr int64_t Src_bias = Src::bias;
+    constexpr uint64_t Dst_E_mask = Dst::E_mask;
+    constexpr uint64_t Dst_M_mask = Dst::M_mask;
+    constexpr int64_t Dst_bias = Dst::bias;
+
+    const bool sign = (bin_value >> (SrcE + SrcM)) & 1;
+    const uint64_t E_other = (bin_value >> SrcM) & Src_E_mask;
+    const uint64_t M_other = bin_value & Src_M_mask;
+    const uint64_t sign_bit = static_cast<uint64_t>(sign) << (DstE + DstM);
+    FLOATINGPOINT_PROFILE_SCOPE(ProfileConvert);
+
+    if constexpr (SrcE == DstE && SrcM == DstM && std::is_same_v<SrcTraits, DstTraits>)
+    {
+        return bin_value & (((1ULL << (SrcE + SrcM)) - 1) | (1ULL << (SrcE + SrcM)));
+    }
+
+    // converting a signaling NaN is invalid
+    if (Src::has_infinity && E_other == Src_E_mask && M_other != 0 && (M_other >> (SrcM - 1)) == 0)
+    {
+        raise_flags(FlagInvalid);
+    }
+
+    // infinity keeps a zero mantissa, NAN keeps the top of its payload and is made quiet
+    uint64_t payload;
+    if constexpr (DstM >= SrcM)
+        payload = M_other << (DstM - SrcM);
+    else
+        payload = M_other >> (SrcM - DstM);
+    const uint64_t special = (Dst_E_mask << DstM) | (M_other != 0 ? payload | (1ULL << (DstM - 1)) : 0);
+
+    if constexpr (Src::ieee && Dst::ieee && DstE >= SrcE && DstM >= SrcM)
+    { // widening: every value is exact, only the fields move
+        uint64_t normal = ((E_other + Dst_bias - Src_bias) << DstM) | payload;
+        uint64_t subnormal;
+        if constexpr (DstE > SrcE)
+        { // subnormals become normal, renormalize on the leading one
+            int lead = findFirstOneBit(M_other);
+            uint64_t E_new = static_cast<uint64_t>(Dst_bias - Src_bias + 1 - SrcM + lead);
+            subnormal = M_other == 0 ? 0 : (E_new << DstM) | ((M_other << (DstM - lead)) & Dst_M_mask);
+        }
+        else
+        {
+            subnormal = payload;
+        }
+        return sign_bit | (E_other == Src_E_mask ? special : E_other == 0 ? subnormal : normal);
+    }
+    else
+    { // narrowing: decode to an integer significand and round into the new format
+        const uint64_t magnitude = bin_value & Src::magnitude_mask;
+        if (Src::is_nan(magnitude))
+        {
+            if constexpr (!Dst::has_nan)
+            {
+                raise_flags(FlagInvalid);
+                return 0;
+            }
+            return sign_bit | (Dst::has_infinity ? special : Dst::quiet_nan);
+        }
+        if (Src::is_infinity(magnitude))
+        {
+            if constexpr (!Dst::has_infinity)
+            {
+                raise_flags(FlagOverflow | FlagInexact);
+                return sign_bit | Dst::template overflow<mode>(sign);
+            }
+            return sign_bit | Dst::infinity;
+        }
+        uint64_t sig = (E_other == 0) ? M_other : M_other | (Src_M_mask + 1);
+        if (sig == 0)
+        {
+            return sign_bit;
+        }
+        int64_t exp = ((E_other == 0) ? 1 : static_cast<int64_t>(E_other)) - Src_bias - SrcM;
+        return round_pack<DstE, DstM, mode, DstTraits>(sign, exp, sig);
+    }
+}
+
+// Smallest unsigned integer able to hold a 1 + exponent + mantissa bit encoding
+template <int bits>
+using FloatingPointStorage = std::conditional_t<bits <= 8, uint8_t,
+                             std::conditional_t<bits <= 16, uint16_t,
+                             std::conditional_t<bits <= 32, uint32_t, uint64_t>>>;
+
+template <int exponent, int mantissa, class Traits>
+class FloatingPoint;
+
+// Value of a chain of operations (a * b + c * d + e, ...) kept unpacked between steps:
+// sign, a signed 64-bit exponent and a 63-bit significand with its leading one at bit
+// 62. add, sub, mul and fma work on it directly, without renormalizing and packing
+// into a format after every step. Each step keeps 63 bits and jams whatever falls below
+// into bit 0 (round to odd), and the value is only rounded into a format, with at most
+// 60 mantissa bits, by an explicit conversion or an assignment. Rounding to odd on two
+// more bits than the format and then into the format is the same as rounding once, so
+// a single operation gives exactly what FloatingPoint's own operation gives, flags
+// included; a chain only differs by carrying 63 bits from one step to the next.
+//
+// The exponent does not overflow or underflow in any practical chain, so overflow,
+// underflow and inexact are raised when the value is rounded, and invalid by the step
+// that makes a NaN. An exact cancellation rounds to +0, or -0 when rounded downward,
+// as in FloatingPoint; a later step takes it as +0.
+class FloatingPointUnpacked
+{
+public:
+    // +0
+    constexpr FloatingPointUnpacked() = default;
+
+    // Exact: every FloatingPoint value fits
+    template <int exponent, int mantissa, class Traits>
+    constexpr FloatingPointUnpacked(const FloatingPoint<exponent, mantissa, Traits> &value)
+        : sign(value.get_sign()), state(value.get_state())
+    {
+        if (state == Normal || state == Subnormal)
+        {
+            state = Normal;
+            sig = value.unpack_normalized(exp) << (lead_bit - mantissa);
+            exp -= lead_bit - mantissa;
+        }
+        else if (state == Nan)
+        {
+            // payload left-aligned, the quiet bit at the leading bit
+            sig = value.get_M_value() << (lead_bit + 1 - mantissa);
+        }
+    }
+
+    constexpr bool get_sign() const { return sign; }
+    constexpr State get_state() const { return state; }
+
+    // Encoding of this value rounded into <exponent, mantissa>
+    template <int exponent, int mantissa, Rounding mode = RoundNearestEven, class Traits = IEEETraits>
+    constexpr uint64_t round() const
+    {
+        static_assert(mantissa <= lead_bit - 2, "an unpacked value rounds once only into formats two bits narrower");
+        using Encoding = FloatingPointEncoding<exponent, mantissa, Traits>;
+        const uint64_t sign_bit = static_cast<uint64_t>(sign) << (exponent + mantissa);
+        FLOATINGPOINT_PROFILE_SCOPE(ProfileConvert);
+
+        if (state == Normal)
+        {
+            return round_pack<exponent, mantissa, mode, Traits>(sign, exp, sig);
+        }
+        if (state == Zero)
+        {
+            // sig marks an exact cancellation, whose sign is the rounding mode's
+            return sig != 0 && mode == RoundDownward ? sign_bit ^ (1ULL << (exponent + mantissa)) : sign_bit;
+        }
+        if (state == Inf)
+        {
+            if constexpr (!Encoding::has_infinity)
+            {
+                raise_flags(FlagOverflow | FlagInexact);
+                return sign_bit | Encoding::template overflow<mode>(sign);
+            }
+            return sign_bit | Encoding::infinity;
+        }
+        // NaN, handled as convert() does
+        if (is_signaling() || !Encoding::has_nan)
+        {
+            raise_flags(FlagInvalid);
+        }
+        if constexpr (!Encoding::has_nan)
+        {
+            return 0;
+        }
+        else if constexpr (Encoding::has_infinity)
+        {
+            return sign_bit | Encoding::infinity | (sig >> (lead_bit + 1 - mantissa)) | (1ULL << (mantissa - 1));
+        }
+        return sign_bit | Encoding::quiet_nan;
+    }
+
+    // This value rounded into FP, e.g. u.to<Half, RoundTowardZero>(); FP(u) and
+    // assigning u to an FP round to nearest even
+    template <class FP, Rounding mode = RoundNearestEven>
+    constexpr FP to() const
+    {
+        return FP(round<FP::E_length, FP::M_length, mode, typename FP::traits_type>());
+    }
+
+    constexpr FloatingPointUnpacked operator-() const
+    {
+        FloatingPointUnpacked result = *this;
+        result.sign = !sign;
+        return result;
+    }
+
+    constexpr FloatingPointUnpacked add(const FloatingPointUnpacked &other) const
+    {
+        FLOATINGPOINT_PROFILE_SCOPE(ProfileAdd);
+        if (state == Nan || other.state == Nan)
+        {
+            return propagate_nan(other);
+        }
+        if (state == Inf)
+        {
+            return (other.state == Inf && sign != other.sign) ? invalid() : *this;
+        }
+        if (other.state == Inf)
+        {
+            return other;
+        }
+        if (state == Zero)
+        {
+            return (other.state == Zero && sign != other.sign) ? cancelled() : other;
+        }
+        if (other.state == Zero)
+        {
+            return *this;
+        }
+
+        // The larger magnitude in the high word, the other shifted down to it: the sum
+        // is exact down to bit 0 and sticky tells whether the smaller one had bits below
+        const bool swap = other.exp > exp || (other.exp == exp && other.sig > sig);
+        const FloatingPointUnpacked &x = swap ? other : *this;
+        const FloatingPointUnpacked &y = swap ? *this : other;
+        const uint64_t exp_diff = static_cast<uint64_t>(x.exp - y.exp);
+        const unsigned __int128 big = static_cast<unsigned __int128>(x.sig) << 64;
+        unsigned __int128 small = 0;
+        bool sticky = true;
+        if (exp_diff < 128)
+        {
+            small = (static_cast<unsigned __int128>(y.sig) << 64) >> exp_diff;
+            sticky = exp_diff > 64 && (y.sig & ((1ULL << (exp_diff - 64)) - 1)) != 0;
+        }
+        // a subtraction that lost bits of the smaller one truncates one below
+        const unsigned __int128 sum = (x.sign == y.sign) ? big + small : big - small - sticky;
+        const uint64_t high = static_cast<uint64_t>(sum >> 64);
+        if (high == 0)
+        {
+            // cancellation this deep leaves an exact result
+            const uint64_t low = static_cast<uint64_t>(sum);
+            return low == 0 ? cancelled() : finite(x.sign, x.exp - 64, low, false);
+        }
+        const int drop = findFirstOneBit(high) + 64 - lead_bit;
+        sticky = sticky || (sum & ((static_cast<unsigned __int128>(1) << drop) - 1)) != 0;
+        return FloatingPointUnpacked(x.sign, Normal, x.exp - 64 + drop, static_cast<uint64_t>(sum >> drop) | sticky);
+    }
+    friend constexpr FloatingPointUnpacked add(const FloatingPointUnpacked &a, const FloatingPointUnpacked &b)
+    {
+        return a.add(b);
+    }
+    friend constexpr FloatingPointUnpacked operator+(const FloatingPointUnpacked &a, const FloatingPointUnpacked &b)
+    {
+        return a.add(b);
+    }
+    constexpr FloatingPointUnpacked &operator+=(const FloatingPointUnpacked &other)
+    {
+        *this = add(other);
+        return *this;
+    }
+
+    constexpr FloatingPointUnpacked sub(const FloatingPointUnpacked &other) const
+    {
+        return add(-other);
+    }
+    friend constexpr FloatingPointUnpacked sub(const FloatingPointUnpacked &a, const FloatingPointUnpacked &b)
+    {
+        return a.sub(b);
+    }
+    friend constexpr FloatingPointUnpacked operator-(const FloatingPointUnpacked &a, const FloatingPointUnpacked &b)
+    {
+        return a.sub(b);
+    }
+    constexpr FloatingPointUnpacked &operator-=(const FloatingPointUnpacked &other)
+    {
+        *this = sub(other);
+        return *this;
+    }
+
+    constexpr FloatingPointUnpacked mul(const FloatingPointUnpacked &other) const
+    {
+        FLOATINGPOINT_PROFILE_SCOPE(ProfileMul);
+        if (state == Nan || other.state == Nan)
+        {
+            return propagate_nan(other);
+        }
+        const bool result_sign = sign ^ other.sign;
+        if (state == Inf || other.state == Inf)
+        {
+            return (state == Zero || other.state == Zero) ? invalid() : FloatingPointUnpacked(result_sign, Inf);
+        }
+        if (state == Zero || other.state == Zero)
+        {
+            return FloatingPointUnpacked(result_sign, Zero);
+        }
+
+        // the product of two 63-bit significands has 125 or 126 bits
+        uint64_t high;
+        const uint64_t low = multiply_wide(sig, other.sig, high);
+        return product(result_sign, exp + other.exp, (static_cast<unsigned __int128>(high) << 64) | low);
+    }
+    friend constexpr FloatingPointUnpacked mul(const FloatingPointUnpacked &a, const FloatingPointUnpacked &b)
+    {
+        return a.mul(b);
+    }
+    friend constexpr FloatingPointUnpacked operator*(const FloatingPointUnpacked &a, const FloatingPointUnpacked &b)
+    {
+        return a.mul(b);
+    }
+    constexpr FloatingPointUnpacked &operator*=(const FloatingPointUnpacked &other)
+    {
+        *this = mul(other);
+        return *this;
+    }
+
+    // *this * b + c, with the exact product
+    constexpr FloatingPointUnpacked fma(const FloatingPointUnpacked &b, const FloatingPointUnpacked &c) const
+    {
+        FLOATINGPOINT_PROFILE_SCOPE(ProfileFma);
+        if (state == Nan || b.state == Nan)
+        {
+            if (c.is_signaling())
+            {
+                raise_flags(FlagInvalid);
+            }
+            return propagate_nan(b);
+        }
+        if (c.state == Nan)
+        {
+            return c.propagate_nan(c);
+        }
+
+        const bool product_sign = sign ^ b.sign;
+        if (state == Inf || b.state == Inf)
+        {
+            if (state == Zero || b.state == Zero || (c.state == Inf && c.sign != product_sign))
+            {
+                return invalid();
+            }
+            return FloatingPointUnpacked(product_sign, Inf);
+        }
+        if (c.state == Inf)
+        {
+            return c;
+        }
+        if (state == Zero || b.state == Zero)
+        {
+            return (c.state == Zero && c.sign != product_sign) ? cancelled() : c;
+        }
+
+        uint64_t high;
+        const uint64_t low = multiply_wide(sig, b.sig, high);
+        const unsigned __int128 exact = (static_cast<unsigned __int128>(high) << 64) | low;
+        if (c.state == Zero)
+        {
+            return product(product_sign, exp + b.exp, exact);
+        }
+        bool result_sign;
+        int64_t result_exp;
+        bool sticky = false;
+        const uint64_t sum = fused_sum(result_sign, result_exp, sticky, product_sign, exp + b.exp, exact, c.sign, c.exp, c.sig);
+        return sum == 0 ? cancelled() : finite(result_sign, result_exp, sum, sticky);
+    }
+    friend constexpr FloatingPointUnpacked fma(const FloatingPointUnpacked &a, const FloatingPointUnpacked &b,
+                                               const FloatingPointUnpacked &c)
+    {
+        return a.fma(b, c);
+    }
+
+private:
+    static constexpr int lead_bit = 62;
+
+    constexpr FloatingPointUnpacked(bool sign, State state, int64_t exp = 0, uint64_t sig = 0)
+        : sign(sign), state(state), exp(exp), sig(sig) {}
+
+    // sig * 2^exp, sig non-zero with its leading one at most at bit 63, moved to the
+    // leading bit and rounded to odd
+    static constexpr FloatingPointUnpacked finite(bool sign, int64_t exp, uint64_t sig, bool sticky)
+    {
+        const int shift = lead_bit - findFirstOneBit(sig);
+        if (shift < 0)
+        {
+            sticky = sticky || (sig & 1);
+            sig >>= 1;
+        }
+        else
+        {
+            sig <<= shift;
+        }
+        return FloatingPointUnpacked(sign, Normal, exp - shift, sig | sticky);
+    }
+
+    // value * 2^exp for a non-zero 128-bit product of two significands
+    static constexpr FloatingPointUnpacked product(bool sign, int64_t exp, unsigned __int128 value)
+    {
+        const int drop = findFirstOneBit128(value) - lead_bit;
+        const bool sticky = (value & ((static_cast<unsigned __int128>(1) << drop) - 1)) != 0;
+        return finite(sign, exp + drop, static_cast<uint64_t>(value >> drop), sticky);
+    }
+
+    constexpr bool is_signaling() const
+    {
+        return state == Nan && ((sig >> lead_bit) & 1) == 0;
+    }
+
+    // the first NaN operand, made quiet, as FloatingPoint does
+    constexpr FloatingPointUnpacked propagate_nan(const FloatingPointUnpacked &other) const
+    {
+        if (is_signaling() || other.is_signaling())
+        {
+            raise_flags(FlagInvalid);
+        }
+        FloatingPointUnpacked result = (state == Nan) ? *this : other;
+        result.sig |= 1ULL << lead_bit;
+        return result;
+    }
+
+    // zero of an exact cancellation
+    static constexpr FloatingPointUnpacked cancelled()
+    {
+        return FloatingPointUnpacked(false, Zero, 0, 1);
+    }
+
+    // the default NaN, sign set and quiet bit only
+    static constexpr FloatingPointUnpacked invalid()
+    {
+        raise_flags(FlagInvalid);
+        return FloatingPointUnpacked(true, Nan, 0, 1ULL << lead_bit);
+    }
+
+    bool sign = false;
+    State state = Zero;
+    int64_t exp = 0;
+    uint64_t sig = 0;
+};
+
+template <int exponent, int mantissa, class Traits = IEEETraits>
+class FloatingPoint
+{
+    static_assert(exponent > 0 && mantissa > 0 && 1 + exponent + mantissa <= 64,
+                  "FloatingPoint encoding must fit in 64 bits");
+
+public:
+    using storage_type = FloatingPointStorage<1 + exponent + mantissa>;
+
+    static constexpr int E_length = exponent;
+    static constexpr uint64_t E_mask = (1ULL << exponent) - 1;
+
+    static constexpr int M_length = mantissa;
+    static constexpr uint64_t M_mask = (1ULL << mantissa) - 1;
+
+    using traits_type = Traits;
+    static constexpr int64_t E_bias = FloatingPointEncoding<exponent, mantissa, Traits>::bias;
+
+private:
+    template <int other_exponent, int other_mantissa, class other_traits>
+    friend class FloatingPoint;
+
+    using Encoding = FloatingPointEncoding<exponent, mantissa, Traits>;
+
+    // sign | exponent | mantissa, exactly as the modelled format lays it out
+    storage_type bits;
+
+    static constexpr storage_type pack(bool sign, uint64_t E_value, uint64_t M_value)
+    {
+        return static_cast<storage_type>((static_cast<uint64_t>(sign) << (exponent + mantissa)) |
+                                         ((E_value & E_mask) << mantissa) |
+                                         (M_value & M_mask));
+    }
+
+    constexpr bool is_signaling() const
+    {
+        return get_state() == Nan && ((bits >> (mantissa - 1)) & 1) == 0;
+    }
+
+    // Result of an operation with a NaN input: the first NaN operand, made quiet. A
+    // signaling NaN operand makes the operation invalid.
+    constexpr FloatingPoint propagate_nan(const FloatingPoint &other) const
+    {
+        if (is_signaling() || other.is_signaling())
+        {
+            raise_flags(FlagInvalid);
+        }
+        FloatingPoint result = (get_state() == Nan) ? *this : other;
+        result.bits |= static_cast<storage_type>((M_mask >> 1) + 1);
+        return result;
+    }
+
+    // Result of an invalid operation (0 * inf, inf - inf, 0 / 0, sqrt(-1), ...)
+    constexpr static FloatingPoint invalid()
+    {
+        raise_flags(FlagInvalid);
+        return createNaN();
+    }
+
+    // Formats whose every value a host type holds exactly
+    static constexpr bool host_float = Encoding::E_max <= 127 && E_bias <= 127 && mantissa <= 23;
+    static constexpr bool host_double = !host_float && Encoding::E_max <= 1023 && E_bias <= 1023 && mantissa <= 52;
+
+    // fn(*this, others...) computed on a host type wider than the format, double for the
+    // formats float holds and long double for those double holds, so that the result
+    // keeps the bits below the format's last place and rounds once, in the given mode,
+    // into the format; binary32 itself rounding to nearest even takes the host's float
+    // functions, which round to nearest on their own. A host result that lands exactly
+    // on a value of the format is taken as exact: with the 11 bits long double has over
+    // double, about one inexact result of a double-sized format in 2^11 does, and a
+    // directed mode then misses it by one unit in the last place. Where long double is
+    // no wider than double, double-sized formats get double's own rounding. An infinite
+    // or zero result of finite operands can only come from overflow or underflow.
+    template <Rounding mode, class Fn, class... Others>
+    FloatingPoint host_apply(Fn fn, const Others &...others) const
+    {
+        constexpr uint64_t magnitude_mask = Encoding::magnitude_mask;
+        const bool finite = (bits & magnitude_mask) <= Encoding::max_finite &&
+                            (true && ... && ((others.bits & magnitude_mask) <= Encoding::max_finite));
+        if constexpr (exponent == 8 && mantissa == 23 && std::is_same_v<Traits, IEEETraits> && mode == RoundNearestEven)
+        {
+            const float result = fn(binary32_to_float(static_cast<uint32_t>(bits)), binary32_to_float(static_cast<uint32_t>(others.bits))...);
+            raise_flags(finite * (std::isinf(result) * (FlagOverflow | FlagInexact) |
+                                  (result == 0) * (FlagUnderflow | FlagInexact)));
+            return from_bits(std::bit_cast<uint32_t>(result));
+        }
+        else if constexpr (host_float)
+        {
+            const double result = fn(binary64_to_double(convert<exponent, mantissa, 11, 52, RoundNearestEven, Traits>(bits)),
+                                     binary64_to_double(convert<exponent, mantissa, 11, 52, RoundNearestEven, Traits>(others.bits))...);
+            raise_flags(finite * (std::isinf(result) * (FlagOverflow | FlagInexact) |
+                                  (result == 0) * (FlagUnderflow | FlagInexact)));
+            return FloatingPoint(convert<11, 52, exponent, mantissa, mode, IEEETraits, Traits>(std::bit_cast<uint64_t>(result)));
+        }
+        else
+        {
+            const long double result = fn(static_cast<long double>(binary64_to_double(convert<exponent, mantissa, 11, 52, RoundNearestEven, Traits>(bits))),
+                                          static_cast<long double>(binary64_to_double(convert<exponent, mantissa, 11, 52, RoundNearestEven, Traits>(others.bits)))...);
+            raise_flags(finite * (std::isinf(result) * (FlagOverflow | FlagInexact) |
+                                  (result == 0) * (FlagUnderflow | FlagInexact)));
+            if (!std::isfinite(result) || result == 0)
+            { // NaN, infinities and zeros are exact in double
+                return FloatingPoint(convert<11, 52, exponent, mantissa, mode, IEEETraits, Traits>(
+                    std::bit_cast<uint64_t>(static_cast<double>(result))));
+            }
+            // |result| = sig * 2^exp exactly: long double has at most 64 significand bits
+            int result_exp;
+            const long double fraction = std::frexp(std::fabs(result), &result_exp);
+            const uint64_t sig = static_cast<uint64_t>(std::ldexp(fraction, 64));
+            return FloatingPoint(round_pack<exponent, mantissa, mode, Traits>(std::signbit(result), result_exp - 64, sig));
+        }
+    }
+
+    // Rounds 2^z for z = (negative ? -1 : 1) * magnitude * 2^exp, with sticky marking an
+    // inexact magnitude, and applies sign to the result
+    template <Rounding mode>
+    static FloatingPoint exp2_fixed_pack(bool sign, bool negative, unsigned __int128 magnitude, int64_t exp, bool sticky)
+    {
+        // beyond 2^limit the result is far outside the format on either side
+        constexpr int limit = std::min(std::max(exponent + 1, 8), 62);
+        const int lead = findFirstOneBit128(magnitude);
+        if (lead + exp >= limit)
+        {
+            return FloatingPoint(round_pack<exponent, mantissa, mode, Traits>(sign, negative ? -(1LL << 62) : (1LL << 62), 1ULL << 63, true));
+        }
+
+        // z with 64 fraction bits
+        const int64_t shift = exp + 64;
+        if (shift >= 0)
+        {
+            magnitude <<= shift;
+        }
+        else if (shift > -128)
+        {
+            sticky = sticky || (magnitude << (128 + shift)) != 0;
+            magnitude >>= -shift;
+        }
+        else
+        {
+            sticky = true;
+            magnitude = 0;
+        }
+        const __int128 z = negative ? -static_cast<__int128>(magnitude) : static_cast<__int128>(magnitude);
+
+        int64_t result_exp;
+        const uint64_t result = exp2_fixed(z, result_exp);
+        return FloatingPoint(round_pack<exponent, mantissa, mode, Traits>(sign, result_exp, result,
+                                                                  sticky || static_cast<uint64_t>(z) != 0));
+    }
+
+    // exp (natural) or exp2
+    template <Rounding mode, bool natural>
+    FloatingPoint exp_any() const
+    {
+        if constexpr (host_float || host_double)
+        { // the host libm takes NaN, infinities and zeros as they are
+            return host_apply<mode>([](auto x)
+                                    { return natural ? std::exp(x) : std::exp2(x); });
+        }
+        else
+        {
+            const State state = get_state();
+            if (state == Nan)
+            {
+                return propagate_nan(*this);
+            }
+            if (state == Inf)
+            {
+                return get_sign() ? createZero() : *this;
+            }
+            if (state == Zero)
+            {
+                return FloatingPoint(false, E_bias, 0);
+            }
+
+            int64_t exp;
+            uint64_t sig = unpack_normalized(exp);
+            sig <<= 63 - mantissa;
+            exp -= 63 - mantissa;
+            if constexpr (natural)
+            { // x log2(e), with log2(e) to 128 bits and the product kept to 128
+                const unsigned __int128 product = static_cast<unsigned __int128>(sig) * 0xB8AA3B295C17F0BBULL +
+                                                  multiply_high(sig, 0xBE87FED0691D3E88ULL);
+                return exp2_fixed_pack<mode>(false, get_sign(), product, exp - 63, true);
+            }
+            else
+            {
+                return exp2_fixed_pack<mode>(false, get_sign(), sig, exp, false);
+            }
+        }
+    }
+
+    // log2 (natural = false) or ln (natural = true) of a finite non-zero value's
+    // magnitude: returns the significand with its leading one at bit 63, or 0 when the
+    // result is 0, and sets sign, exp, and exact when nothing was rounded on the way
+    template <bool natural>
+    uint64_t log_wide(bool &sign, int64_t &exp, bool &exact) const
+    {
+        int64_t k;
+        uint64_t sig = unpack_normalized(k);
+        sig <<= 63 - mantissa;
+        k += mantissa;
+
+        bool m_sign = false;
+        int64_t m_exp = 0;
+        uint64_t m_log = log_fixed(sig, k, m_sign, m_exp);
+        exact = m_log == 0;
+        if constexpr (!natural)
+        {
+            if (m_log != 0)
+            { // ln m' log2(e), log2(e) to 64 bits
+                m_log = multiply_high(m_log, 0xB8AA3B295C17F0BBULL);
+                m_exp += 1;
+                if ((m_log >> 63) == 0)
+                {
+                    m_log <<= 1;
+                    --m_exp;
+                }
+            }
+        }
+        if (k == 0)
+        {
+            sign = m_sign;
+            exp = m_exp;
+            return m_log;
+        }
+
+        // k ln2 or k, plus the part of m', with 64 fraction bits; |ln m'| < 1/2
+        __int128 sum = natural ? static_cast<__int128>(k) * 0xB17217F7D1CF79ABULL : static_cast<__int128>(k) * (static_cast<__int128>(1) << 64);
+        exact = exact && !natural;
+        if (m_log != 0)
+        {
+            const int64_t shift = -(m_exp + 64);
+            const __int128 part = shift < 128 ? static_cast<__int128>(static_cast<unsigned __int128>(m_log) >> shift) : 0;
+            sum += m_sign ? -part : part;
+        }
+        sign = sum < 0;
+        const unsigned __int128 magnitude = sign ? -static_cast<unsigned __int128>(sum) : static_cast<unsigned __int128>(sum);
+        // at least 1/2 for log2, ln2 - 1/2 for ln
+        const int drop = findFirstOneBit128(magnitude) - 63;
+        exp = drop - 64;
+        if (drop < 0)
+        {
+            return static_cast<uint64_t>(magnitude << -drop);
+        }
+        exact = exact && (magnitude & ((static_cast<unsigned __int128>(1) << drop) - 1)) == 0;
+        return static_cast<uint64_t>(magnitude >> drop);
+    }
+
+    // log (natural) or log2
+    template <Rounding mode, bool natural>
+    FloatingPoint log_any() const
+    {
+        const State state = get_state();
+        if (state == Nan)
+        {
+            return propagate_nan(*this);
+        }
+        if (state == Zero)
+        {
+            raise_flags(FlagDivideByZero);
+            return createInfinity(true);
+        }
+        if (get_sign())
+        {
+            return invalid();
+        }
+        if (state == Inf)
+        {
+            return *this;
+        }
+        if (bits == FloatingPoint(false, E_bias, 0).bits)
+        {
+            return createZero();
+        }
+
+        if constexpr (host_float || host_double)
+        {
+            return host_apply<mode>([](auto x)
+                                    { return natural ? std::log(x) : std::log2(x); });
+        }
+        else
+        {
+            bool sign, exact;
+            int64_t exp;
+            const uint64_t result = log_wide<natural>(sign, exp, exact);
+            return FloatingPoint(round_pack<exponent, mantissa, mode, Traits>(sign, exp, result, !exact));
+        }
+    }
+
+public:
+    constexpr bool get_sign() const { return (bits >> (exponent + mantissa)) & 1; }
+    constexpr uint64_t get_E_value() const { return (bits >> mantissa) & E_mask; }
+    constexpr uint64_t get_M_value() const { return bits & M_mask; }
+    constexpr int get_E_length() const { return E_length; }
+    constexpr int get_M_length() const { return M_length; }
+    constexpr uint64_t get_E_mask() const { return E_mask; }
+    constexpr uint64_t get_M_mask() const { return M_mask; }
+    constexpr State get_state() const { return update_state(*this); }
+
+    // Integer significand (implicit one included) of a finite value; exp receives the
+    // exponent of its lowest bit, so the value is significand * 2^exp
+    constexpr uint64_t unpack(int64_t &exp) const
+    {
+        uint64_t E_value = get_E_value();
+        exp = ((E_value == 0) ? 1 : static_cast<int64_t>(E_value)) - E_bias - mantissa;
+        return (E_value == 0) ? get_M_value() : get_M_value() | (M_mask + 1);
+    }
+
+    // unpack() of a finite non-zero value with the leading one moved up to bit `mantissa`,
+    // so subnormals come out shaped like normals
+    constexpr uint64_t unpack_normalized(int64_t &exp) const
+    {
+        uint64_t sig = unpack(exp);
+        int shift = mantissa - findFirstOneBit(sig);
+        exp -= shift;
+        return sig << shift;
+    }
+
+    // Print the state of the floating point number
+    void print_state() const
+    {
+        std::cout << "Decimal: " << To_decimal() << std::endl;
+        std::cout << "Sign: " << get_sign() << "\n";
+        std::cout << "Exponent: 0b" << std::bitset<exponent>(get_E_value()) << "\n";
+        std::cout << "Mantissa: 0b" << std::bitset<mantissa>(get_M_value()) << "\n";
+        std::cout << "State: ";
+        switch (get_state())
+        {
+        case Normal:
+            std::cout << "Normal\n";
+            break;
+        case Subnormal:
+            std::cout << "Subnormal\n";
+            break;
+        case Zero:
+            std::cout << "Zero\n";
+            break;
+        case Inf:
+            std::cout << "Inf\n";
+            break;
+        case Nan:
+            std::cout << "NaN\n";
+            break;
+        }
+    }
+
+    constexpr State update_state(FloatingPoint value) const
+    {
+        uint64_t E_value = value.get_E_value();
+        uint64_t M_value = value.get_M_value();
+        const uint64_t magnitude = value.bits & Encoding::magnitude_mask;
+        if (E_value == 0 && M_value == 0)
+        {
+            return Zero;
+        }
+        else if (E_value == 0 && M_value != 0)
+        {
+            return Subnormal;
+        }
+        else if (Encoding::is_infinity(magnitude))
+        {
+            return Inf;
+        }
+        else if (Encoding::is_nan(magnitude))
+        {
+            return Nan;
+        }
+        else
+        {
+            return Normal;
+        }
+    }
+
+    // The value as a host float or double: the fields are moved into the IEEE layout,
+    // rounding to nearest even only when the format does not fit
+    constexpr float to_float() const
+    {
+        return binary32_to_float(convert<exponent, mantissa, 8, 23, RoundNearestEven, Traits>(bits));
+    }
+
+    constexpr double to_double() const
+    {
+        return binary64_to_double(convert<exponent, mantissa, 11, 52, RoundNearestEven, Traits>(bits));
+    }
+
+    double To_decimal() const
+    {
+        return to_double();
+    }
+
+    // Formats without infinity give their largest finite value when saturating, NaN
+    // otherwise
+    constexpr static FloatingPoint createInfinity(bool sign)
+    {
+        constexpr uint64_t magnitude = Encoding::has_infinity ? Encoding::infinity
+                                       : Traits::saturating   ? Encoding::max_finite
+                                                              : Encoding::quiet_nan;
+        return FloatingPoint(sign, magnitude >> mantissa, magnitude);
+    }
+
+    constexpr static FloatingPoint createZero(bool sign = false)
+    {
+        return FloatingPoint(sign, 0, 0);
+    }
+
+    // Default NaN produced by invalid operations (sign set, quiet bit only, as x86 does);
+    // the single NaN of E4M3-style formats, and zero in formats without NaN
+    constexpr static FloatingPoint createNaN()
+    {
+        return FloatingPoint(Encoding::has_nan, Encoding::quiet_nan >> mantissa, Encoding::quiet_nan);
+    }
+
+    // change the floatingpoint into binary form
+    template <int other_exponent, int other_mantissa, class other_traits>
+    uint64_t Bin(FloatingPoint<other_exponent, other_mantissa, other_traits> value) const
+    {
+        uint64_t result = (static_cast<uint64_t>(value.get_sign()) << (value.get_E_length() + value.get_M_length())) |
+                          ((value.get_E_value()) << value.get_M_length()) |
+                          (value.get_M_value());
+        return result;
+    }
+
+    // Default: Initialize to Floating Point 0
+    constexpr FloatingPoint() : bits(0) {}
+
+    // Initialize with binary value
+    constexpr FloatingPoint(const uint64_t val_binary)
+        : bits(pack((val_binary >> (exponent + mantissa)) & 1, val_binary >> mantissa, val_binary)) {}
+
+    // Initialize with class type
+    constexpr FloatingPoint(bool sign, uint64_t E_value, uint64_t M_value) : bits(pack(sign, E_value, M_value)) {}
+
+    // Initialize with int value, rounded to nearest even like the float and double
+    // constructors; 0 gives +0
+    constexpr FloatingPoint(int value) : bits(0)
+    {
+        FLOATINGPOINT_PROFILE_SCOPE(ProfileConvert);
+        const bool sign = value < 0;
+        const uint64_t magnitude = sign ? 0 - static_cast<uint64_t>(static_cast<int64_t>(value)) : static_cast<uint64_t>(value);
+        if (magnitude != 0)
+            bits = static_cast<storage_type>(round_pack<exponent, mantissa, RoundNearestEven, Traits>(sign, 0, magnitude));
+    }
+
+    // Initialize with float value
+    constexpr FloatingPoint(float value)
+        : bits(static_cast<storage_type>(convert<8, 23, exponent, mantissa, RoundNearestEven, IEEETraits, Traits>(
+              std::bit_cast<uint32_t>(value)))) {}
+
+    // Initialize with double value
+    constexpr FloatingPoint(double value)
+        : bits(static_cast<storage_type>(convert<11, 52, exponent, mantissa, RoundNearestEven, IEEETraits, Traits>(
+              std::bit_cast<uint64_t>(value)))) {}
+
+    // Initialize with other floatingpoint value
+    template <int other_exponent, int other_mantissa, class other_traits>
+    constexpr FloatingPoint(const FloatingPoint<other_exponent, other_mantissa, other_traits> &value)
+        : bits(static_cast<storage_type>(convert<other_exponent, other_mantissa, exponent, mantissa, RoundNearestEven,
+                                                 other_traits, Traits>(value.bits))) {}
+
+    // Round an unpacked intermediate into the format; explicit, so that an expression
+    // mixing the two stays unpacked
+    explicit constexpr FloatingPoint(const FloatingPointUnpacked &value)
+        : bits(static_cast<storage_type>(value.round<exponent, mantissa, RoundNearestEven, Traits>())) {}
+
+    template <int other_exponent, int other_mantissa, class other_traits>
+    constexpr FloatingPoint &operator=(const FloatingPoint<other_exponent, other_mantissa, other_traits> &value)
+    {
+        bits = static_cast<storage_type>(convert<other_exponent, other_mantissa, exponent, mantissa, RoundNearestEven,
+                                                 other_traits, Traits>(value.bits));
+        return *this;
+    }
+
+    constexpr FloatingPoint &operator=(int value)
+    {
+        bits = FloatingPoint(value).bits;
+        return *this;
+    }
+
+    constexpr FloatingPoint &operator=(float value)
+    {
+        bits = FloatingPoint(value).bits;
+        return *this;
+    }
+
+    constexpr FloatingPoint &operator=(double value)
+    {
+        bits = FloatingPoint(value).bits;
+        return *this;
+    }
+
+    constexpr FloatingPoint &operator=(uint64_t value)
+    {
+        bits = FloatingPoint(value).bits;
+        return *this;
+    }
+
+    constexpr FloatingPoint &operator=(const FloatingPointUnpacked &value)
+    {
+        bits = FloatingPoint(value).bits;
+        return *this;
+    }
+
+    // The value whose encoding is code, which must fit in 1 + exponent + mantissa bits
+    static constexpr FloatingPoint from_bits(storage_type code) { return std::bit_cast<FloatingPoint>(code); }
+
+    // The encoding of this value, sign | exponent | mantissa
+    constexpr storage_type to_bits() const { return std::bit_cast<storage_type>(*this); }
+
+    // This value rounded into another format with the given rounding mode; the converting
+    // constructors and assignments round to nearest even
+    template <int other_exponent, int other_mantissa, Rounding mode = RoundNearestEven, class other_traits = IEEETraits>
+    constexpr FloatingPoint<other_exponent, other_mantissa, other_traits> to() const
+    {
+        return FloatingPoint<other_exponent, other_mantissa, other_traits>(
+            convert<exponent, mantissa, other_exponent, other_mantissa, mode, Traits, other_traits>(bits));
+    }
+
+    // to() with the target named by its type, e.g. x.to<E4M3, RoundTowardZero>()
+    template <class Other, Rounding mode = RoundNearestEven>
+    constexpr Other to() const
+    {
+        return to<Other::E_length, Other::M_length, mode, typename Other::traits_type>();
+    }
+
+    /* Unary Operation */
+    constexpr FloatingPoint neg() const
+    {
+        return FloatingPoint(!get_sign(), get_E_value(), get_M_value());
+    }
+
+    constexpr FloatingPoint operator-() const
+    {
+        return neg();
+    }
+
+    friend constexpr FloatingPoint neg(const FloatingPoint &value)
+    {
+        return value.neg();
+    }
+
+    constexpr FloatingPoint abs() const
+    {
+        return FloatingPoint(false, get_E_value(), get_M_value());
+    }
+
+    friend constexpr FloatingPoint abs(const FloatingPoint &value)
+    {
+        return value.abs();
+    }
+
+    // Square root by restoring digit recurrence on the significand, one root bit per step
+    template <Rounding mode = RoundNearestEven>
+    constexpr FloatingPoint sqrt() const
+    {
+        FLOATINGPOINT_PROFILE_SCOPE(ProfileSqrt);
+        const State state = get_state();
+
+        if (state == Nan)
+        {
+            return propagate_nan(*this);
+        }
+        if (state == Zero)
+        { // sqrt(-0) = -0
+            return *this;
+        }
+        if (get_sign())
+        {
+            return invalid();
+        }
+        if (state == Inf)
+        {
+            return *this;
+        }
+
+        // Normal and Subnormal: scale the significand by 2^shift with exp - shift even and
+        // shift >= mantissa + 3, so the integer root keeps two bits below the rounding
+        // position and the remainder tells whether anything is left below them
+        using Wide = std::conditional_t<(mantissa <= 58), uint64_t, unsigned __int128>;
+        int64_t exp;
+        uint64_t sig = unpack_normalized(exp);
+        const int shift = mantissa + 3 + static_cast<int>((exp - mantissa - 3) & 1);
+        sig <<= shift & 1;
+        const int low_pairs = shift / 2;
+        const int sig_pairs = (findFirstOneBit(sig) + 2) / 2;
+
+        Wide remainder = 0;
+        uint64_t root = 0;
+        for (int i = sig_pairs + low_pairs - 1; i >= 0; --i)
+        {
+            uint64_t pair = (i >= low_pairs) ? (sig >> (2 * (i - low_pairs))) & 3 : 0;
+            remainder = (remainder << 2) | pair;
+            Wide trial = (static_cast<Wide>(root) << 2) | 1;
+            bool digit = remainder >= trial;
+            remainder -= digit ? trial : 0;
+            root = (root << 1) | digit;
+        }
+
+        return FloatingPoint(round_pack<exponent, mantissa, mode, Traits>(false, (exp - shift) / 2, root, remainder != 0));
+    }
+
+    // exp, exp2, log, log2 and pow. Formats a host float or double holds exactly run
+    // the host libm and round its result once into the format; there only that rounding,
+    // overflow and underflow to zero raise flags. The others (CA25, ...) are
+    // computed in the format itself: range reduction on the integer exponent and
+    // fixed-point polynomials on the significand, within 2^-60 of the exact value before
+    // the final rounding. pow() goes through log2, so near the ends of CA25's range it
+    // may be an ulp off.
+    template <Rounding mode = RoundNearestEven>
+    FloatingPoint exp() const
+    {
+        return exp_any<mode, true>();
+    }
+    template <Rounding mode = RoundNearestEven>
+    friend FloatingPoint exp(const FloatingPoint &fp)
+    {
+        return fp.exp<mode>();
+    }
+
+    template <Rounding mode = RoundNearestEven>
+    FloatingPoint exp2() const
+    {
+        return exp_any<mode, false>();
+    }
+    template <Rounding mode = RoundNearestEven>
+    friend FloatingPoint exp2(const FloatingPoint &fp)
+    {
+        return fp.exp2<mode>();
+    }
+
+    template <Rounding mode = RoundNearestEven>
+    FloatingPoint log() const
+    {
+        return log_any<mode, true>();
+    }
+    template <Rounding mode = RoundNearestEven>
+    friend FloatingPoint log(const FloatingPoint &fp)
+    {
+        return fp.log<mode>();
+    }
+
+    template <Rounding mode = RoundNearestEven>
+    FloatingPoint log2() const
+    {
+        return log_any<mode, false>();
+    }
+    template <Rounding mode = RoundNearestEven>
+    friend FloatingPoint log2(const FloatingPoint &fp)
+    {
+        return fp.log2<mode>();
+    }
+
+    // *this raised to y, with the special cases of C's pow()
+    template <Rounding mode = RoundNearestEven>
+    FloatingPoint pow(const FloatingPoint &y) const
+    {
+        const State state = get_state();
+        const State y_state = y.get_state();
+        const FloatingPoint one(false, E_bias, 0);
+
+        if (y_state == Zero || bits == one.bits)
+        {
+            return one;
+        }
+        if (state == Nan || y_state == Nan)
+        {
+            return propagate_nan(y);
+        }
+
+        // whether y is an integer, and an odd one
+        bool y_integer = true, y_odd = false;
+        if (y_state != Inf)
+        {
+            int64_t exp;
+            const uint64_t sig = y.unpack(exp);
+            if (exp < 0)
+            {
+                y_integer = -exp < 64 && (sig & ((1ULL << -exp) - 1)) == 0;
+                y_odd = y_integer && ((sig >> -exp) & 1);
+            }
+            else
+            {
+                y_odd = exp == 0 && (sig & 1);
+            }
+        }
+
+        const bool sign = get_sign() && y_odd;
+        const bool y_sign = y.get_sign();
+        if (state == Zero)
+        {
+            if (y_sign)
+            {
+                raise_flags(FlagDivideByZero);
+                return createInfinity(sign);
+            }
+            return createZero(sign);
+        }
+        if (y_state == Inf)
+        {
+            const FloatingPoint magnitude = abs();
+            if (magnitude.bits == one.bits)
+            {
+                return one;
+            }
+            return (magnitude < one) != y_sign ? createZero() : createInfinity(false);
+        }
+        if (state == Inf)
+        {
+            return y_sign ? createZero(sign) : createInfinity(sign);
+        }
+        if (get_sign() && !y_integer)
+        {
+            return invalid();
+        }
+
+        if constexpr (host_float || host_double)
+        {
+            // the sign is applied before rounding, so that the directed modes round the
+            // signed result
+            return abs().template host_apply<mode>([sign](auto x, auto y)
+                                                   { return sign ? -std::pow(x, y) : std::pow(x, y); }, y);
+        }
+        else
+        {
+            // |x|^y = 2^(y log2|x|)
+            bool log_sign, exact;
+            int64_t log_exp;
+            const uint64_t log = log_wide<false>(log_sign, log_exp, exact);
+            if (log == 0)
+            {
+                return sign ? one.neg() : one;
+            }
+            int64_t y_exp;
+            uint64_t y_sig = y.unpack_normalized(y_exp);
+            y_sig <<= 63 - mantissa;
+            y_exp -= 63 - mantissa;
+
+            const unsigned __int128 product = static_cast<unsigned __int128>(y_sig) * log;
+            return exp2_fixed_pack<mode>(sign, log_sign != y_sign, product, y_exp + log_exp, !exact);
+        }
+    }
+    template <Rounding mode = RoundNearestEven>
+    friend FloatingPoint pow(const FloatingPoint &x, const FloatingPoint &y)
+    {
+        return x.pow<mode>(y);
+    }
+
+    // max(x, 0); a NaN of either sign comes back quieted, with its sign and payload
+    constexpr FloatingPoint relu() const
+    {
+        if (get_state() == Nan)
+        {
+            return propagate_nan(*this);
+        }
+        if (get_sign())
+        {
+            return createZero();
+        }
+        else
+        {
+            return (*this);
+        }
+    }
+    friend constexpr FloatingPoint relu(const FloatingPoint &fp)
+    {
+        return fp.relu();
+    }
+
+    // Addition
+    template <Rounding mode = RoundNearestEven>
+    constexpr FloatingPoint add(const FloatingPoint &other) const
+    {
+        static_assert(mantissa <= 59, "add() keeps three spare bits below bit 63");
+        FLOATINGPOINT_PROFILE_SCOPE(ProfileAdd);
+
+        const bool sign = get_sign();
+        const State state = get_state();
+        const State other_state = other.get_state();
+
+        if (state == Nan || other_state == Nan)
+        {
+            return propagate_nan(other);
+        }
+
+        if (state == Inf)
+        {
+            if (other_state == Inf && sign != other.get_sign())
+            {
+                return invalid();
+            }
+            return *this;
+        }
+
+        if (other_state == Inf)
+        {
+            return other;
+        }
+
+        if (state == Zero)
+        {
+            // zeros of opposite sign sum to +0, or -0 when rounding down
+            return (other_state == Zero && sign != other.get_sign()) ? createZero(mode == RoundDownward) : other;
+        }
+
+        if (other_state == Zero)
+        {
+            return *this;
+        }
+
+        // Normal and Subnormal, ordered so that the first operand has the larger magnitude
+        constexpr uint64_t magnitude_mask = (E_mask << mantissa) | M_mask;
+        const bool swap = (bits & magnitude_mask) < (other.bits & magnitude_mask);
+        const FloatingPoint &x = swap ? other : *this;
+        const FloatingPoint &y = swap ? *this : other;
+
+        bool sign1 = x.get_sign();
+        int64_t exp1, exp2;
+        uint64_t mantissa1 = x.unpack(exp1);
+        uint64_t mantissa2 = y.unpack(exp2);
+
+        // Put the leading one at bit 62 so the sum cannot carry out of the word and
+        // at least two guard bits survive a one-bit cancellation
+        constexpr int lead_shift = 62 - mantissa;
+        mantissa1 <<= lead_shift;
+        mantissa2 <<= lead_shift;
+
+        // Align exponents by shifting the smaller number's mantissa right; bits shifted
+        // out are jammed into the lowest bit so rounding still sees them
+        int64_t exp_diff = exp1 - exp2;
+        bool sticky = false;
+        if (exp_diff >= 64)
+        {
+            sticky = true;
+            mantissa2 = 0;
+        }
+        else if (exp_diff > 0)
+        {
+            sticky = (mantissa2 << (64 - exp_diff)) != 0;
+            mantissa2 >>= exp_diff;
+        }
+        mantissa2 |= sticky;
+
+        // Perform addition or subtraction based on signs
+        uint64_t result_mantissa = (sign1 == y.get_sign()) ? mantissa1 + mantissa2 : mantissa1 - mantissa2;
+        if (result_mantissa == 0)
+        {
+            return createZero(mode == RoundDownward);
+        }
+
+        return FloatingPoint(round_pack<exponent, mantissa, mode, Traits>(sign1, exp1 - lead_shift, result_mantissa));
+    }
+    template <Rounding mode = RoundNearestEven>
+    friend constexpr FloatingPoint add(const FloatingPoint &fp1, const FloatingPoint &fp2)
+    {
+        return fp1.add<mode>(fp2);
+    }
+    constexpr FloatingPoint operator+(const FloatingPoint &other) const
+    {
+        return add(other);
+    };
+    friend constexpr FloatingPoint operator+(int val, const FloatingPoint &fp)
+    {
+        return FloatingPoint(val) + fp;
+    }
+    friend constexpr FloatingPoint operator+(const FloatingPoint &fp, int val)
+    {
+        return fp + FloatingPoint(val);
+    }
+    friend constexpr FloatingPoint operator+(double val, const FloatingPoint &fp)
+    {
+        return FloatingPoint(val) + fp;
+    }
+    friend constexpr FloatingPoint operator+(const FloatingPoint &fp, double val)
+    {
+        return fp + FloatingPoint(val);
+    }
+    constexpr FloatingPoint operator+=(const FloatingPoint &other)
+    {
+        *this = add(other);
+        return *this;
+    }
+    constexpr FloatingPoint operator+=(int val)
+    {
+        *this = add(FloatingPoint(val));
+        return *this;
+    }
+    constexpr FloatingPoint operator+=(double val)
+    {
+        *this = add(FloatingPoint(val));
+        return *this;
+    }
+
+    // Subtraction
+    template <Rounding mode = RoundNearestEven>
+    constexpr FloatingPoint sub(const FloatingPoint &other) const
+    {
+        return add<mode>(other.neg());
+    }
+    template <Rounding mode = RoundNearestEven>
+    friend constexpr FloatingPoint sub(const FloatingPoint &fp1, const FloatingPoint &fp2)
+    {
+        return fp1.sub<mode>(fp2);
+    }
+    constexpr FloatingPoint operator-(const FloatingPoint &other) const
+    {
+        return sub(other);
+    };
+    friend constexpr FloatingPoint operator-(int val, const FloatingPoint &fp)
+    {
+        return FloatingPoint(val) - fp;
+    }
+    friend constexpr FloatingPoint operator-(const FloatingPoint &fp, int val)
+    {
+        return fp - FloatingPoint(val);
+    }
+    friend constexpr FloatingPoint operator-(double val, const FloatingPoint &fp)
+    {
+        return FloatingPoint(val) - fp;
+    }
+    friend constexpr FloatingPoint operator-(const FloatingPoint &fp, double val)
+    {
+        return fp - FloatingPoint(val);
+    }
+    constexpr FloatingPoint operator-=(const FloatingPoint &other)
+    {
+        *this = sub(other);
+        return *this;
+    }
+    constexpr FloatingPoint operator-=(int val)
+    {
+        *this = sub(FloatingPoint(val));
+        return *this;
+    }
+    constexpr FloatingPoint operator-=(double val)
+    {
+        *this = sub(FloatingPoint(val));
+        return *this;
+    }
+
+    // Multiplication
+    template <Rounding mode = RoundNearestEven>
+    constexpr FloatingPoint mul(const FloatingPoint &other) const
+    {
+        FLOATINGPOINT_PROFILE_SCOPE(ProfileMul);
+        const bool sign = get_sign();
+        const State state = get_state();
+        const State other_state = other.get_state();
+
+        if (state == Nan || other_state == Nan)
+        {
+            return propagate_nan(other);
+        }
+
+        // Calculate result sign (XOR of input signs)
+        bool result_sign = sign ^ other.get_sign();
+
+        if (state == Inf || other_state == Inf)
+        {
+            if (state == Zero || other_state == Zero)
+            {
+                return invalid();
+            }
+            return createInfinity(result_sign);
+        }
+
+        if (state == Zero || other_state == Zero)
+        {
+            return FloatingPoint(result_sign, 0, 0);
+        }
+
+        // Normal and Subnormal
+        int64_t exp1, exp2;
+        uint64_t mantissa1 = unpack(exp1);
+        uint64_t mantissa2 = other.unpack(exp2);
+
+        int64_t result_exp = exp1 + exp2;
+
+        // Fold the 128-bit product into 64 bits, keeping a sticky bit for what falls off
+        uint64_t high;
+        uint64_t low = multiply_wide(mantissa1, mantissa2, high);
+        uint64_t result_mantissa = low;
+        bool sticky = false;
+        if (high != 0)
+        {
+            int shift = findFirstOneBit(high) + 1;
+            result_mantissa = (high << (64 - shift)) | (low >> shift);
+            sticky = (low << (64 - shift)) != 0;
+            result_exp += shift;
+        }
+
+        return FloatingPoint(round_pack<exponent, mantissa, mode, Traits>(result_sign, result_exp, result_mantissa, sticky));
+    }
+    template <Rounding mode = RoundNearestEven>
+    friend constexpr FloatingPoint mul(const FloatingPoint &fp1, const FloatingPoint &fp2)
+    {
+        return fp1.mul<mode>(fp2);
+    }
+    constexpr FloatingPoint operator*(const FloatingPoint &other) const
+    {
+        return mul(other);
+    };
+    friend constexpr FloatingPoint operator*(int val, const FloatingPoint &fp)
+    {
+        return FloatingPoint(val) * fp;
+    }
+    friend constexpr FloatingPoint operator*(double val, const FloatingPoint &fp)
+    {
+        return FloatingPoint(val) * fp;
+    }
+    friend constexpr FloatingPoint operator*(const FloatingPoint &fp, int val)
+    {
+        return fp * FloatingPoint(val);
+    }
+    friend constexpr FloatingPoint operator*(const FloatingPoint &fp, double val)
+    {
+        return fp * FloatingPoint(val);
+    }
+    constexpr FloatingPoint operator*=(const FloatingPoint &other)
+    {
+        *this = mul(other);
+        return *this;
+    }
+    constexpr FloatingPoint operator*=(int val)
+    {
+        *this = mul(val);
+        return *this;
+    }
+    constexpr FloatingPoint operator*=(double val)
+    {
+        *this = mul(val);
+        return *this;
+    }
+
+    // Fused multiply-add: *this * b + c with a single rounding
+    template <Rounding mode = RoundNearestEven>
+    constexpr FloatingPoint fma(const FloatingPoint &b, const FloatingPoint &c) const
+    {
+        static_assert(mantissa <= 59, "fma() keeps the product and addend in 126 bits");
+        FLOATINGPOINT_PROFILE_SCOPE(ProfileFma);
+
+        const State state = get_state();
+        const State b_state = b.get_state();
+        const State c_state = c.get_state();
+
+        // the first NaN operand wins, as for the host fma
+        if (state == Nan || b_state == Nan)
+        {
+            if (c.is_signaling())
+            {
+                raise_flags(FlagInvalid);
+            }
+            return propagate_nan(b);
+        }
+        if (c_state == Nan)
+        {
+            return c.propagate_nan(c);
+        }
+
+        const bool product_sign = get_sign() ^ b.get_sign();
+
+        if (state == Inf || b_state == Inf)
+        {
+            if (state == Zero || b_state == Zero || (c_state == Inf && c.get_sign() != product_sign))
+            {
+                return invalid();
+            }
+            return createInfinity(product_sign);
+        }
+        if (c_state == Inf)
+        {
+            return c;
+        }
+        if (state == Zero || b_state == Zero)
+        {
+            // an exact zero product adds like add() does
+            return (c_state == Zero && c.get_sign() != product_sign) ? createZero(mode == RoundDownward) : c;
+        }
+
+        // Normal and Subnormal: the exact product keeps all of its 128 bits
+        int64_t exp1, exp2;
+        uint64_t mantissa1 = unpack(exp1);
+        uint64_t mantissa2 = b.unpack(exp2);
+        uint64_t high;
+        uint64_t low = multiply_wide(mantissa1, mantissa2, high);
+        unsigned __int128 product = (static_cast<unsigned __int128>(high) << 64) | low;
+
+        bool result_sign;
+        int64_t result_exp;
+        uint64_t result_mantissa;
+        bool sticky = false;
+        if (c_state == Zero)
+        {
+            // a non-zero product plus a zero is the product rounded once
+            int drop = std::max((high != 0 ? 64 + findFirstOneBit(high) : findFirstOneBit(low)) - 63, 0);
+            sticky = (product & ((static_cast<unsigned __int128>(1) << drop) - 1)) != 0;
+            result_sign = product_sign;
+            result_exp = exp1 + exp2 + drop;
+            result_mantissa = static_cast<uint64_t>(product >> drop);
+        }
+        else
+        {
+            int64_t exp3;
+            uint64_t mantissa3 = c.unpack(exp3);
+            result_mantissa = fused_sum(result_sign, result_exp, sticky,
+                                        product_sign, exp1 + exp2, product,
+                                        c.get_sign(), exp3, mantissa3);
+            if (result_mantissa == 0)
+            {
+                return createZero(mode == RoundDownward);
+            }
+        }
+
+        return FloatingPoint(round_pack<exponent, mantissa, mode, Traits>(result_sign, result_exp, result_mantissa, sticky));
+    }
+    template <Rounding mode = RoundNearestEven>
+    friend constexpr FloatingPoint fma(const FloatingPoint &a, const FloatingPoint &b, const FloatingPoint &c)
+    {
+        return a.fma<mode>(b, c);
+    }
+
+    // Division
+    template <Rounding mode = RoundNearestEven>
+    constexpr FloatingPoint div(const FloatingPoint &other) const
+    {
+        FLOATINGPOINT_PROFILE_SCOPE(ProfileDiv);
+        const State state = get_state();
+        const State other_state = other.get_state();
+
+        if (state == Nan || other_state == Nan)
+        {
+            return propagate_nan(other);
+        }
+
+        bool result_sign = get_sign() ^ other.get_sign();
+
+        if (state == Inf)
+        {
+            return (other_state == Inf) ? invalid() : createInfinity(result_sign);
+        }
+        if (other_state == Inf)
+        {
+            return FloatingPoint(result_sign, 0, 0);
+        }
+        if (other_state == Zero)
+        {
+            if (state == Zero)
+            {
+                return invalid();
+            }
+            raise_flags(FlagDivideByZero);
+            return createInfinity(result_sign);
+        }
+        if (state == Zero)
+        {
+            return FloatingPoint(result_sign, 0, 0);
+        }
+
+        // Normal and Subnormal: both significands in [2^mantissa, 2^(mantissa + 1)), so a
+        // dividend widened by mantissa + 3 bits gives a quotient with two guard bits and
+        // the remainder tells whether anything is left below them
+        int64_t exp1, exp2;
+        uint64_t mantissa1 = unpack_normalized(exp1);
+        uint64_t mantissa2 = other.unpack_normalized(exp2);
+
+        constexpr int quotient_shift = mantissa + 3;
+        uint64_t result_mantissa;
+        bool sticky;
+        if constexpr (mantissa + 1 + quotient_shift <= 64)
+        {
+            uint64_t dividend = mantissa1 << quotient_shift;
+            result_mantissa = dividend / mantissa2;
+            sticky = (dividend % mantissa2) != 0;
+        }
+        else
+        {
+            unsigned __int128 dividend = static_cast<unsigned __int128>(mantissa1) << quotient_shift;
+            result_mantissa = static_cast<uint64_t>(dividend / mantissa2);
+            sticky = (dividend % mantissa2) != 0;
+        }
+
+        return FloatingPoint(round_pack<exponent, mantissa, mode, Traits>(result_sign, exp1 - exp2 - quotient_shift, result_mantissa, sticky));
+    }
+    template <Rounding mode = RoundNearestEven>
+    friend constexpr FloatingPoint div(const FloatingPoint &fp1, const FloatingPoint &fp2)
+    {
+        return fp1.div<mode>(fp2);
+    }
+    constexpr FloatingPoint operator/(const FloatingPoint &other) const
+    {
+        return div(other);
+    };
+    friend constexpr FloatingPoint operator/(int val, const FloatingPoint &fp)
+    {
+        return FloatingPoint(val) / fp;
+    }
+    friend constexpr FloatingPoint operator/(double val, const FloatingPoint &fp)
+    {
+        return FloatingPoint(val) / fp;
+    }
+    friend constexpr FloatingPoint operator/(const FloatingPoint &fp, int val)
+    {
+        return fp / FloatingPoint(val);
+    }
+    friend constexpr FloatingPoint operator/(const FloatingPoint &fp, double val)
+    {
+        return fp / FloatingPoint(val);
+    }
+    constexpr FloatingPoint operator/=(const FloatingPoint &other)
+    {
+        *this = div(other);
+        return *this;
+    }
+    constexpr FloatingPoint operator/=(int val)
+    {
+        *this = div(val);
+        return *this;
+    }
+    constexpr FloatingPoint operator/=(double val)
+    {
+        *this = div(val);
+        return *this;
+    }
+
+    // Comparison Operator. A NaN compares unordered: only != holds. The ordered
+    // comparisons with a NaN are invalid, == and != only with a signaling NaN.
+    constexpr bool operator==(const FloatingPoint &other) const
+    {
+        if ((get_state() == Nan) || (other.get_state() == Nan))
+        {
+            if (is_signaling() || other.is_signaling())
+            {
+                raise_flags(FlagInvalid);
+            }
+            return false;
+        }
+        // +0 == -0
+        return bits == other.bits || (get_state() == Zero && other.get_state() == Zero);
+    };
+    constexpr bool operator!=(const FloatingPoint &other) const
+    {
+        return !(*this == other);
+    };
+    constexpr bool operator<(const FloatingPoint &other) const
+    {
+        if ((get_state() == Nan) || (other.get_state() == Nan))
+        {
+            raise_flags(FlagInvalid);
+            return false;
+        }
+        if (get_state() == Zero && other.get_state() == Zero)
+        {
+            return false;
+        }
+        const bool sign = get_sign();
+        if (sign != other.get_sign())
+        {
+            return sign;
+        }
+        else if (get_E_value() != other.get_E_value())
+        {
+            return sign ? get_E_value() > other.get_E_value() : get_E_value() < other.get_E_value();
+        }
+        else
+        {
+            return sign ? get_M_value() > other.get_M_value() : get_M_value() < other.get_M_value();
+        }
+    };
+    constexpr bool operator<=(const FloatingPoint &other) const
+    {
+        return *this < other || (*this == other);
+    };
+    constexpr bool operator>(const FloatingPoint &other) const
+    {
+        return other < *this;
+    };
+    constexpr bool operator>=(const FloatingPoint &other) const
+    {
+        return other <= *this;
+    };
+};
+
 #endif // FLOATINGPOINT_HPP_
\ No newline at end of file
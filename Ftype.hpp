@@ -1,13 +1,30 @@
-#ifndef FTYPE_HPP_
-#define FTYPE_HPP_
-
-#include <cmath>
-#include <iostream>
-#include "FloatingPoint_1.hpp"
-
-using Half = FloatingPoint<5, 10>;    // 16-bit floating point (5 exponent, 10 mantissa)
-using Float = FloatingPoint<8, 23>;   // 32-bit floating point (8 exponent, 23 mantissa)
-using Double = FloatingPoint<11, 52>; // 64-bit floating point (11 exponent, 52 mantissa)
-using CA25 = FloatingPoint<32, 31>;   // Custom 64-bit floating point (32 exponent, 31 mantissa)
-
+#ifndef FTYPE_HPP_
+#define FTYPE_HPP_
+
+#include <cmath>
+#include <iostream>
+#include "FloatingPoint_1.hpp"
+
+using Half = FloatingPoint<5, 10>;    // 16-bit floating point (5 exponent, 10 mantissa)
+using Float = FloatingPoint<8, 23>;   // 32-bit floating point (8 exponent, 23 mantissa)
+using Double = FloatingPoint<11, 52>; // 64-bit floating point (11 exponent, 52 mantissa)
+using CA25 = FloatingPoint<32, 31>;   // Custom 64-bit floating point (32 exponent, 31 mantissa)
+
+using BFloat16 = FloatingPoint<8, 7>; // bfloat16 (8 exponent, 7 mantissa)
+using TF32 = FloatingPoint<8, 10>;    // TensorFloat-32, kept in 32 bits (8 exponent, 10 mantissa)
+
+// OCP 8-bit formats. E5M2 follows IEEE; E4M3 has no infinity, S.1111.111 is its only
+// NaN, and overflow saturates at +-448
+using E5M2 = FloatingPoint<5, 2>;
+using E4M3 = FloatingPoint<4, 3, FloatingPointTraits<0, SpecialsNanOnly, true>>;
+
+// OCP MX element formats: no infinity or NaN, overflow saturates
+using E3M2 = FloatingPoint<3, 2, FloatingPointTraits<0, SpecialsNone>>; // FP6
+using E2M3 = FloatingPoint<2, 3, FloatingPointTraits<0, SpecialsNone>>; // FP6
+using E2M1 = FloatingPoint<2, 1, FloatingPointTraits<0, SpecialsNone>>; // FP4
+
+static_assert(sizeof(Half) == 2 && sizeof(Float) == 4 && sizeof(Double) == 8 && sizeof(CA25) == 8 &&
+                  sizeof(BFloat16) == 2 && sizeof(E5M2) == 1 && sizeof(E4M3) == 1 && sizeof(E2M1) == 1,
+              "FloatingPoint must occupy the same storage as the format it models");
+
 #endif // FTYPE_HPP_
\ No newline at end of file
@@ -0,0 +1,180 @@
+#ifndef GEMM_HPP_
+#define GEMM_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <span>
+#include <thread>
+#include <vector>
+#include "Batch.hpp"
+
+// Mixed-precision matrix multiply C = A * B over emulated formats, all row-major:
+// A is m x k, B is k x n and C is m x n.
+//
+// Every element of C is accumulated in AccT as acc = fma(A[i][p], B[p][j], acc) for
+// p = 0, 1, ..., k - 1 starting from +0, with the inputs converted to AccT first, and
+// is converted to OutT once at the end. The order over p is fixed, so the result does
+// not depend on the tiling or on the number of threads.
+//
+// C is cut into block_m x block_n tiles shared out between the threads; a tile walks
+// k in panels of block_k, converting the A and B panels to AccT once and keeping the
+// accumulators of the whole tile live across panels. A Float or Double accumulator
+// runs on the host fma, which rounds exactly like fma() on the same values; the other
+// formats go through fma_accumulate(). The flags raised on every thread end up in the
+// calling thread's.
+
+struct GemmTiling
+{
+    size_t block_m = 64;
+    size_t block_n = 256;
+    size_t block_k = 256;
+    unsigned threads = 0; // 0 takes std::thread::hardware_concurrency()
+};
+
+namespace gemm_detail
+{
+    // Host type an accumulator format is stored as, void when there is none
+    template <class AccT>
+    struct host_type
+    {
+        using type = void;
+    };
+    template <>
+    struct host_type<FloatingPoint<8, 23>>
+    {
+        using type = float;
+    };
+    template <>
+    struct host_type<FloatingPoint<11, 52>>
+    {
+        using type = double;
+    };
+
+    template <class InT, class AccT, class OutT>
+    void tile(const InT *A, const InT *B, OutT *C, size_t n, size_t k,
+              size_t i0, size_t i1, size_t j0, size_t j1, size_t block_k)
+    {
+        using Host = typename host_type<AccT>::type;
+        const size_t rows = i1 - i0;
+        const size_t cols = j1 - j0;
+
+        if constexpr (std::is_void_v<Host>)
+        {
+            // B panels are stored transposed so each accumulator reads two contiguous rows
+            std::vector<AccT> acc(rows * cols, AccT(0.0));
+            std::vector<AccT> a_panel(rows * block_k), b_panel(cols * block_k);
+            for (size_t p0 = 0; p0 < k; p0 += block_k)
+            {
+                const size_t depth = std::min(block_k, k - p0);
+                for (size_t r = 0; r < rows; ++r)
+                    for (size_t p = 0; p < depth; ++p)
+                        a_panel[r * depth + p] = AccT(A[(i0 + r) * k + p0 + p]);
+                for (size_t p = 0; p < depth; ++p)
+                    for (size_t c = 0; c < cols; ++c)
+                        b_panel[c * depth + p] = AccT(B[(p0 + p) * n + j0 + c]);
+
+                for (size_t r = 0; r < rows; ++r)
+                {
+                    std::span<const AccT> a_row(a_panel.data() + r * depth, depth);
+                    for (size_t c = 0; c < cols; ++c)
+                    {
+                        fma_accumulate(a_row, std::span<const AccT>(b_panel.data() + c * depth, depth), acc[r * cols + c]);
+                    }
+                }
+            }
+            for (size_t r = 0; r < rows; ++r)
+                for (size_t c = 0; c < cols; ++c)
+                    C[(i0 + r) * n + j0 + c] = OutT(acc[r * cols + c]);
+        }
+        else
+        {
+            // Row-major B panels: the innermost loop runs along a row of C, so it maps
+            // onto vector lanes while each element still sees p in order
+            auto to_host = [](const InT &value)
+            { return std::bit_cast<Host>(AccT(value).to_bits()); };
+
+            std::vector<Host> acc(rows * cols, Host(0));
+            std::vector<Host> a_panel(rows * block_k), b_panel(block_k * cols);
+            // the host fma raises its flags on the host, collected into the thread's
+            batch_detail::HostExceptions exceptions;
+            for (size_t p0 = 0; p0 < k; p0 += block_k)
+            {
+                const size_t depth = std::min(block_k, k - p0);
+                for (size_t r = 0; r < rows; ++r)
+                    for (size_t p = 0; p < depth; ++p)
+                        a_panel[r * depth + p] = to_host(A[(i0 + r) * k + p0 + p]);
+                for (size_t p = 0; p < depth; ++p)
+                    for (size_t c = 0; c < cols; ++c)
+                        b_panel[p * cols + c] = to_host(B[(p0 + p) * n + j0 + c]);
+
+                for (size_t r = 0; r < rows; ++r)
+                {
+                    Host *acc_row = acc.data() + r * cols;
+                    for (size_t p = 0; p < depth; ++p)
+                    {
+                        const Host a = a_panel[r * depth + p];
+                        const Host *b_row = b_panel.data() + p * cols;
+                        for (size_t c = 0; c < cols; ++c)
+                        {
+                            acc_row[c] = std::fma(a, b_row[c], acc_row[c]);
+                        }
+                    }
+                }
+            }
+            for (size_t r = 0; r < rows; ++r)
+                for (size_t c = 0; c < cols; ++c)
+                    C[(i0 + r) * n + j0 + c] = OutT(AccT(acc[r * cols + c]));
+        }
+    }
+}
+
+template <class InT, class AccT, class OutT>
+void gemm(std::span<const InT> A, std::span<const InT> B, std::span<OutT> C,
+          size_t m, size_t n, size_t k, GemmTiling tiling = {})
+{
+    assert(A.size() == m * k && B.size() == k * n && C.size() == m * n);
+    assert(tiling.block_m > 0 && tiling.block_n > 0 && tiling.block_k > 0);
+
+    const size_t tiles_m = (m + tiling.block_m - 1) / tiling.block_m;
+    const size_t tiles_n = (n + tiling.block_n - 1) / tiling.block_n;
+    const size_t tiles = tiles_m * tiles_n;
+
+    std::atomic<size_t> next{0};
+    auto worker = [&]
+    {
+        for (size_t t = next++; t < tiles; t = next++)
+        {
+            const size_t i0 = (t / tiles_n) * tiling.block_m;
+            const size_t j0 = (t % tiles_n) * tiling.block_n;
+            gemm_detail::tile<InT, AccT, OutT>(A.data(), B.data(), C.data(), n, k,
+                                               i0, std::min(i0 + tiling.block_m, m),
+                                               j0, std::min(j0 + tiling.block_n, n),
+                                               tiling.block_k);
+        }
+    };
+
+    unsigned threads = tiling.threads != 0 ? tiling.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = static_cast<unsigned>(std::min<size_t>(threads, tiles));
+    // the flags of every worker are merged into the caller's
+    std::atomic<unsigned> raised{0};
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; ++i)
+    {
+        pool.emplace_back([&]
+                          {
+            worker();
+            raised |= test_flags(); });
+    }
+    worker();
+    for (std::thread &thread : pool)
+    {
+        thread.join();
+    }
+    raise_flags(raised);
+}
+
+#endif // GEMM_HPP_
@@ -0,0 +1,137 @@
+#ifndef LUT_HPP_
+#define LUT_HPP_
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+#include "FloatingPoint_1.hpp"
+
+// Elementary and activation functions of formats of 16 bits or fewer (Half, FP8, ...)
+// by table lookup. Each function of each format has one table of 2^(1 + exponent +
+// mantissa) encodings, built on first use and shared by all threads; afterwards an
+// element costs a single load indexed by its encoding.
+//
+// Entries are the double result rounded once to the format, so they are correctly
+// rounded except where the double result lies within an ulp of a tie of the format.
+// NaN inputs give the quiet NaN with the same payload; lookups raise no flags.
+
+namespace lut_detail
+{
+    struct Exp
+    {
+        template <class FP>
+        static FP value(const FP &x) { return FP(std::exp(x.to_double())); }
+    };
+    struct Log
+    {
+        template <class FP>
+        static FP value(const FP &x) { return FP(std::log(x.to_double())); }
+    };
+    struct Tanh
+    {
+        template <class FP>
+        static FP value(const FP &x) { return FP(std::tanh(x.to_double())); }
+    };
+    struct Sigmoid
+    {
+        template <class FP>
+        static FP value(const FP &x) { return FP(1.0 / (1.0 + std::exp(-x.to_double()))); }
+    };
+    struct Gelu
+    {
+        // exact form 0.5 x (1 + erf(x / sqrt(2))), not the tanh approximation
+        template <class FP>
+        static FP value(const FP &x)
+        {
+            const double v = x.to_double();
+            return FP(0.5 * v * (1.0 + std::erf(v * 0.70710678118654752440)));
+        }
+    };
+    struct Relu
+    {
+        template <class FP>
+        static FP value(const FP &x) { return x.relu(); }
+    };
+
+    // Table of Fn over every encoding of FP, built once by the first caller
+    template <class FP, class Fn>
+    const typename FP::storage_type *table()
+    {
+        static_assert(FP::E_length + FP::M_length + 1 <= 16,
+                      "lookup tables cover formats of 16 bits or fewer");
+        static_assert(std::is_standard_layout_v<FP> && sizeof(FP) == sizeof(typename FP::storage_type),
+                      "lookup tables hold FloatingPoint values as their packed encodings");
+        using storage_type = typename FP::storage_type;
+
+        static const std::vector<storage_type> entries = []
+        {
+            constexpr size_t size = size_t(1) << (FP::E_length + FP::M_length + 1);
+            const unsigned flags = test_flags();
+            std::vector<storage_type> result(size);
+            for (size_t code = 0; code < size; ++code)
+            {
+                result[code] = Fn::value(FP(static_cast<uint64_t>(code))).to_bits();
+            }
+            // building the table is not part of any caller's computation
+            clear_flags();
+            raise_flags(flags);
+            return result;
+        }();
+        return entries.data();
+    }
+
+    template <class FP, class Fn>
+    FP lookup(const FP &x)
+    {
+        return FP::from_bits(table<FP, Fn>()[x.to_bits()]);
+    }
+
+    template <class FP, class Fn>
+    void lookup(std::span<const FP> in, std::span<FP> out)
+    {
+        assert(in.size() == out.size());
+        using storage_type = typename FP::storage_type;
+        const storage_type *entries = table<FP, Fn>();
+        const storage_type *codes = reinterpret_cast<const storage_type *>(in.data());
+        storage_type *results = reinterpret_cast<storage_type *>(out.data());
+        for (size_t i = 0; i < in.size(); ++i)
+        {
+            results[i] = entries[codes[i]];
+        }
+    }
+}
+
+namespace lut
+{
+    template <int e, int m, class T>
+    FloatingPoint<e, m, T> exp(const FloatingPoint<e, m, T> &x) { return lut_detail::lookup<FloatingPoint<e, m, T>, lut_detail::Exp>(x); }
+    template <int e, int m, class T>
+    FloatingPoint<e, m, T> log(const FloatingPoint<e, m, T> &x) { return lut_detail::lookup<FloatingPoint<e, m, T>, lut_detail::Log>(x); }
+    template <int e, int m, class T>
+    FloatingPoint<e, m, T> tanh(const FloatingPoint<e, m, T> &x) { return lut_detail::lookup<FloatingPoint<e, m, T>, lut_detail::Tanh>(x); }
+    template <int e, int m, class T>
+    FloatingPoint<e, m, T> sigmoid(const FloatingPoint<e, m, T> &x) { return lut_detail::lookup<FloatingPoint<e, m, T>, lut_detail::Sigmoid>(x); }
+    template <int e, int m, class T>
+    FloatingPoint<e, m, T> gelu(const FloatingPoint<e, m, T> &x) { return lut_detail::lookup<FloatingPoint<e, m, T>, lut_detail::Gelu>(x); }
+    template <int e, int m, class T>
+    FloatingPoint<e, m, T> relu(const FloatingPoint<e, m, T> &x) { return lut_detail::lookup<FloatingPoint<e, m, T>, lut_detail::Relu>(x); }
+
+    // out[i] = f(in[i]); in and out may be the same array
+    template <int e, int m, class T>
+    void exp(std::span<const FloatingPoint<e, m, T>> in, std::span<FloatingPoint<e, m, T>> out) { lut_detail::lookup<FloatingPoint<e, m, T>, lut_detail::Exp>(in, out); }
+    template <int e, int m, class T>
+    void log(std::span<const FloatingPoint<e, m, T>> in, std::span<FloatingPoint<e, m, T>> out) { lut_detail::lookup<FloatingPoint<e, m, T>, lut_detail::Log>(in, out); }
+    template <int e, int m, class T>
+    void tanh(std::span<const FloatingPoint<e, m, T>> in, std::span<FloatingPoint<e, m, T>> out) { lut_detail::lookup<FloatingPoint<e, m, T>, lut_detail::Tanh>(in, out); }
+    template <int e, int m, class T>
+    void sigmoid(std::span<const FloatingPoint<e, m, T>> in, std::span<FloatingPoint<e, m, T>> out) { lut_detail::lookup<FloatingPoint<e, m, T>, lut_detail::Sigmoid>(in, out); }
+    template <int e, int m, class T>
+    void gelu(std::span<const FloatingPoint<e, m, T>> in, std::span<FloatingPoint<e, m, T>> out) { lut_detail::lookup<FloatingPoint<e, m, T>, lut_detail::Gelu>(in, out); }
+    template <int e, int m, class T>
+    void relu(std::span<const FloatingPoint<e, m, T>> in, std::span<FloatingPoint<e, m, T>> out) { lut_detail::lookup<FloatingPoint<e, m, T>, lut_detail::Relu>(in, out); }
+}
+
+#endif // LUT_HPP_
@@ -0,0 +1,487 @@
+#ifndef REDUCE_HPP_
+#define REDUCE_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <thread>
+#include <vector>
+#include "Batch.hpp"
+
+// Reductions over arrays of emulated values spread over threads: sum(), dot() and
+// l2norm() accumulate in a format AccT chosen by the caller (Half data summed in Float
+// or CA25, ...); max_abs() and argmax() are exact and work on the encodings.
+//
+// The input is cut into blocks of 128 elements, each converted to AccT and summed in
+// 8 interleaved lanes, element i going to lane i % 8. The block results are then
+// combined according to the Summation:
+// - SummationPairwise: lanes combined as ((0 + 1) + (2 + 3)) + ((4 + 5) + (6 + 7)),
+//   and the block sums pairwise by halving their list recursively, so the error grows
+//   with log n rather than n
+// - SummationKahan: every lane, and the block sums taken in order, carry a Neumaier
+//   (improved Kahan) compensation term that is added back at the end
+// dot() accumulates a[i] * b[i] with fma() under SummationPairwise, and under
+// SummationKahan adds the product and its rounding error, recovered with fma(), to the
+// compensated sum.
+//
+// Blocks are fixed by position and combined in a fixed order, so the result does not
+// depend on the number of threads (0 takes std::thread::hardware_concurrency()). A
+// Float or Double accumulator runs on host arithmetic, which rounds exactly like AccT;
+// the other formats on AccT's operators. The flags raised on every thread reach the
+// caller.
+
+enum Summation
+{
+    SummationPairwise,
+    SummationKahan
+};
+
+namespace reduce_detail
+{
+    inline constexpr size_t block = 128;
+    inline constexpr size_t lanes = 8;
+    // Blocks a thread claims at a time
+    inline constexpr size_t run = 256;
+
+    // Type the accumulation runs on: the host type of Float and Double, AccT otherwise
+    template <class AccT>
+    struct arith_type
+    {
+        using type = AccT;
+    };
+    template <>
+    struct arith_type<FloatingPoint<8, 23>>
+    {
+        using type = float;
+    };
+    template <>
+    struct arith_type<FloatingPoint<11, 52>>
+    {
+        using type = double;
+    };
+
+    // lanes values of A side by side: a host vector for float and double, so that the
+    // lanes live in vector registers, and an array of AccT with the same operators
+    // otherwise
+    template <class A>
+    struct Lanes
+    {
+        A v[lanes] = {};
+
+        A &operator[](size_t j) { return v[j]; }
+        const A &operator[](size_t j) const { return v[j]; }
+
+        friend Lanes operator+(const Lanes &a, const Lanes &b) { return each(a, b, [](const A &x, const A &y) { return x + y; }); }
+        friend Lanes operator-(const Lanes &a, const Lanes &b) { return each(a, b, [](const A &x, const A &y) { return x - y; }); }
+        friend Lanes operator*(const Lanes &a, const Lanes &b) { return each(a, b, [](const A &x, const A &y) { return x * y; }); }
+        friend Lanes operator-(const Lanes &a) { return each(a, a, [](const A &x, const A &) { return -x; }); }
+
+    private:
+        template <class Op>
+        static Lanes each(const Lanes &a, const Lanes &b, Op op)
+        {
+            Lanes result;
+            for (size_t j = 0; j < lanes; ++j)
+                result.v[j] = op(a.v[j], b.v[j]);
+            return result;
+        }
+    };
+
+    template <class A>
+    struct lane_type
+    {
+        using type = Lanes<A>;
+    };
+    template <>
+    struct lane_type<float>
+    {
+        typedef float type __attribute__((vector_size(lanes * sizeof(float))));
+        typedef int32_t bits __attribute__((vector_size(lanes * sizeof(float))));
+    };
+    template <>
+    struct lane_type<double>
+    {
+        typedef double type __attribute__((vector_size(lanes * sizeof(double))));
+        typedef int64_t bits __attribute__((vector_size(lanes * sizeof(double))));
+    };
+
+    // The helpers below hand lanes back through a reference: a host vector wider than
+    // the enabled ISA returned by value changes the calling convention (-Wpsabi)
+
+    // p[0, count) into lanes, the missing lanes +0; adding +0 leaves a lane as it is
+    template <class A>
+    void load(const A *p, size_t count, typename lane_type<A>::type &result)
+    {
+        result = typename lane_type<A>::type{};
+        if (count == lanes)
+            std::memcpy(static_cast<void *>(&result), p, sizeof(result));
+        else
+            std::memcpy(static_cast<void *>(&result), p, count * sizeof(A));
+    }
+
+    // result = fma(a, b, c) lane by lane; result may be c
+    template <class A>
+    void fma_lanes(const typename lane_type<A>::type &a, const typename lane_type<A>::type &b,
+                   const typename lane_type<A>::type &c, typename lane_type<A>::type &result)
+    {
+        using std::fma;
+        for (size_t j = 0; j < lanes; ++j)
+            result[j] = fma(a[j], b[j], c[j]);
+    }
+
+    // Rounding error of t = s + x, exact: the larger of s and x in magnitude minus t,
+    // plus the other. Both candidates are computed so that choosing is a select on
+    // vector lanes; the one not taken raises no flag the addition did not.
+    template <class A>
+    void sum_error(const typename lane_type<A>::type &s, const typename lane_type<A>::type &x,
+                   const typename lane_type<A>::type &t, typename lane_type<A>::type &error)
+    {
+        using V = typename lane_type<A>::type;
+        const V error_s = (s - t) + x;
+        const V error_x = (x - t) + s;
+        if constexpr (std::is_floating_point_v<A>)
+        {
+            // |s| >= |x| compared on the magnitude bits, which order as the values do
+            using Bits = typename lane_type<A>::bits;
+            const Bits magnitude = Bits{} + static_cast<typename std::remove_reference_t<decltype(Bits{}[0])>>(~0ULL >> (65 - 8 * sizeof(A)));
+            error = ((reinterpret_cast<const Bits &>(s) & magnitude) >= (reinterpret_cast<const Bits &>(x) & magnitude)) ? error_s : error_x;
+        }
+        else
+        {
+            for (size_t j = 0; j < lanes; ++j)
+                error[j] = abs(s[j]) >= abs(x[j]) ? error_s[j] : error_x[j];
+        }
+    }
+
+    template <class A>
+    bool is_finite(const A &x)
+    {
+        if constexpr (std::is_floating_point_v<A>)
+            return std::isfinite(x);
+        else
+            return x.get_state() != Inf && x.get_state() != Nan;
+    }
+
+    // s + x, with the rounding error of the addition added to c
+    template <class A>
+    void add_compensated(A &s, A &c, const A &x)
+    {
+        using std::abs;
+        const A t = s + x;
+        c = c + (abs(s) >= abs(x) ? (s - t) + x : (x - t) + s);
+        s = t;
+    }
+
+    // Compensated sum of a run of values or products, one block at a time
+    template <class A, bool product>
+    void kahan_blocks(const A *a, const A *b, size_t n, A *sums, A *errors)
+    {
+        using V = typename lane_type<A>::type;
+        for (size_t first = 0; first < n; first += block)
+        {
+            const size_t length = std::min(block, n - first);
+            V s{}, c{};
+            for (size_t i = 0; i < length; i += lanes)
+            {
+                const size_t count = std::min(lanes, length - i);
+                V x, error;
+                load(a + first + i, count, x);
+                if constexpr (product)
+                {
+                    V y, residual;
+                    load(b + first + i, count, y);
+                    const V p = x * y;
+                    const V t = s + p;
+                    sum_error<A>(s, p, t, error);
+                    fma_lanes<A>(x, y, -p, residual);
+                    c = c + error + residual;
+                    s = t;
+                }
+                else
+                {
+                    const V t = s + x;
+                    sum_error<A>(s, x, t, error);
+                    c = c + error;
+                    s = t;
+                }
+            }
+            A sum = s[0], error = c[0];
+            for (size_t j = 1; j < lanes; ++j)
+            {
+                add_compensated(sum, error, A(s[j]));
+                error = error + c[j];
+            }
+            sums[first / block] = sum;
+            errors[first / block] = error;
+        }
+    }
+
+    // Pairwise sum of a run of values or products, one block at a time
+    template <class A, bool product>
+    void pairwise_blocks(const A *a, const A *b, size_t n, A *sums)
+    {
+        using V = typename lane_type<A>::type;
+        for (size_t first = 0; first < n; first += block)
+        {
+            const size_t length = std::min(block, n - first);
+            V r{};
+            for (size_t i = 0; i < length; i += lanes)
+            {
+                const size_t count = std::min(lanes, length - i);
+                V x;
+                load(a + first + i, count, x);
+                if constexpr (product)
+                {
+                    V y;
+                    load(b + first + i, count, y);
+                    fma_lanes<A>(x, y, r, r);
+                }
+                else
+                {
+                    r = r + x;
+                }
+            }
+            sums[first / block] = ((r[0] + r[1]) + (r[2] + r[3])) + ((r[4] + r[5]) + (r[6] + r[7]));
+        }
+    }
+
+    template <class A>
+    A pairwise(const A *sums, size_t count)
+    {
+        if (count == 1)
+            return sums[0];
+        const size_t half = count / 2;
+        return pairwise(sums, half) + pairwise(sums + half, count - half);
+    }
+
+    // Run work(first, last) over runs of blocks [first, last) on up to threads threads;
+    // every thread calls make_work() once for a callable with its own scratch space
+    template <class MakeWork>
+    void for_runs(size_t blocks, unsigned threads, MakeWork make_work)
+    {
+        const size_t runs = (blocks + run - 1) / run;
+        threads = threads != 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<unsigned>(std::max<size_t>(1, std::min<size_t>(threads, runs)));
+
+        std::atomic<size_t> next{0};
+        std::atomic<unsigned> raised{0};
+        auto worker = [&]
+        {
+            auto work = make_work();
+            for (size_t r = next++; r < runs; r = next++)
+            {
+                work(r * run, std::min(blocks, (r + 1) * run));
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t)
+        {
+            pool.emplace_back([&]
+                              {
+                worker();
+                raised |= test_flags(); });
+        }
+        worker();
+        for (std::thread &thread : pool)
+        {
+            thread.join();
+        }
+        raise_flags(raised);
+    }
+
+    // in[0, n) converted to A into out
+    template <class A, class T>
+    void stage(const T *in, size_t n, A *out)
+    {
+        if constexpr (sizeof(A) == sizeof(T) && std::is_same_v<typename batch_detail::buffer_format<A>::type, T>)
+            std::memcpy(static_cast<void *>(out), in, n * sizeof(T));
+        else
+            batch_detail::convert_host<RoundNearestEven>(in, n, out);
+    }
+
+    // Sum of a[i] (b == nullptr) or of a[i] * b[i] in AccT
+    template <class AccT, class T>
+    AccT accumulate(const T *a, const T *b, size_t n, Summation summation, unsigned threads)
+    {
+        using A = typename arith_type<AccT>::type;
+        if (n == 0)
+            return AccT();
+
+        const size_t blocks = (n + block - 1) / block;
+        std::vector<A> sums(blocks), errors(summation == SummationKahan ? blocks : 0);
+        for_runs(blocks, threads, [&]
+                 { return [&, staged_a = std::vector<A>(run * block), staged_b = std::vector<A>(b ? run * block : 0)](size_t first, size_t last) mutable
+                   {
+                       batch_detail::HostExceptions exceptions;
+                       const size_t begin = first * block;
+                       const size_t length = std::min(n, last * block) - begin;
+                       stage(a + begin, length, staged_a.data());
+                       if (b != nullptr)
+                       {
+                           stage(b + begin, length, staged_b.data());
+                           if (summation == SummationKahan)
+                               kahan_blocks<A, true>(staged_a.data(), staged_b.data(), length, sums.data() + first, errors.data() + first);
+                           else
+                               pairwise_blocks<A, true>(staged_a.data(), staged_b.data(), length, sums.data() + first);
+                       }
+                       else if (summation == SummationKahan)
+                       {
+                           kahan_blocks<A, false>(staged_a.data(), nullptr, length, sums.data() + first, errors.data() + first);
+                       }
+                       else
+                       {
+                           pairwise_blocks<A, false>(staged_a.data(), nullptr, length, sums.data() + first);
+                       }
+                   }; });
+
+        batch_detail::HostExceptions exceptions;
+        A result;
+        if (summation == SummationKahan)
+        {
+            A s = sums[0], c = errors[0];
+            for (size_t k = 1; k < blocks; ++k)
+            {
+                add_compensated(s, c, sums[k]);
+                c = c + errors[k];
+            }
+            // an infinite sum leaves a NaN compensation behind
+            result = is_finite(s) ? s + c : s;
+        }
+        else
+        {
+            result = pairwise(sums.data(), blocks);
+        }
+        return AccT(result);
+    }
+
+    // Integer ordered as the values encoded, -0 equal to +0 and NaN above everything
+    template <class T>
+    int64_t order_key(uint64_t code)
+    {
+        using Encoding = FloatingPointEncoding<T::E_length, T::M_length, typename T::traits_type>;
+        // masks rather than selects, which keeps the block scan of argmax() vectorisable
+        const uint64_t magnitude = code & Encoding::magnitude_mask;
+        const int64_t negative = -static_cast<int64_t>((code >> (T::E_length + T::M_length)) & 1);
+        const int64_t nan = -static_cast<int64_t>(Encoding::is_nan(magnitude));
+        const int64_t key = (static_cast<int64_t>(magnitude) ^ negative) - negative;
+        return (key & ~nan) | (INT64_MAX & nan);
+    }
+}
+
+// x[0] + x[1] + ... in AccT
+template <class AccT, class T>
+AccT sum(std::span<const T> x, Summation summation = SummationPairwise, unsigned threads = 0)
+{
+    return reduce_detail::accumulate<AccT>(x.data(), static_cast<const T *>(nullptr), x.size(), summation, threads);
+}
+
+// a[0] * b[0] + a[1] * b[1] + ... in AccT
+template <class AccT, class T>
+AccT dot(std::span<const T> a, std::span<const T> b, Summation summation = SummationPairwise, unsigned threads = 0)
+{
+    assert(a.size() == b.size());
+    return reduce_detail::accumulate<AccT>(a.data(), b.data(), a.size(), summation, threads);
+}
+
+// sqrt(x[0]^2 + x[1]^2 + ...) in AccT, without rescaling: a sum of squares that
+// overflows AccT gives infinity
+template <class AccT, class T>
+AccT l2norm(std::span<const T> x, Summation summation = SummationPairwise, unsigned threads = 0)
+{
+    return dot<AccT>(x, x, summation, threads).sqrt();
+}
+
+// Largest |x[i]|, +0 for an empty array; a NaN anywhere gives NaN
+template <class T>
+T max_abs(std::span<const T> x, unsigned threads = 0)
+{
+    using storage_type = typename T::storage_type;
+    static_assert(std::is_standard_layout_v<T> && sizeof(T) == sizeof(storage_type),
+                  "reductions read FloatingPoint arrays as their packed encodings");
+    constexpr storage_type magnitude_mask = static_cast<storage_type>((uint64_t(1) << (T::E_length + T::M_length)) - 1);
+    constexpr size_t chunk = reduce_detail::run * reduce_detail::block;
+
+    // |x| orders as its encoding, and NaN encodings lie above infinity
+    const storage_type *codes = reinterpret_cast<const storage_type *>(x.data());
+    const size_t blocks = (x.size() + reduce_detail::block - 1) / reduce_detail::block;
+    std::vector<storage_type> partial((x.size() + chunk - 1) / chunk, 0);
+    reduce_detail::for_runs(blocks, threads, [&]
+                            { return [&](size_t first, size_t last)
+                              {
+                                  const size_t begin = first * reduce_detail::block;
+                                  const size_t end = std::min(x.size(), last * reduce_detail::block);
+                                  storage_type largest = 0;
+                                  for (size_t i = begin; i < end; ++i)
+                                  {
+                                      largest = std::max<storage_type>(largest, codes[i] & magnitude_mask);
+                                  }
+                                  partial[first / reduce_detail::run] = largest;
+                              }; });
+    storage_type largest = 0;
+    for (storage_type value : partial)
+    {
+        largest = std::max(largest, value);
+    }
+    return T::from_bits(largest);
+}
+
+// Index of the first largest x[i], or of the first NaN; x must not be empty
+template <class T>
+size_t argmax(std::span<const T> x, unsigned threads = 0)
+{
+    using storage_type = typename T::storage_type;
+    static_assert(std::is_standard_layout_v<T> && sizeof(T) == sizeof(storage_type),
+                  "reductions read FloatingPoint arrays as their packed encodings");
+    assert(!x.empty());
+    constexpr size_t block = reduce_detail::block;
+    constexpr size_t chunk = reduce_detail::run * block;
+
+    struct Best
+    {
+        int64_t key;
+        size_t index;
+    };
+    // the largest key of a block is found first, on vector lanes, and only a block that
+    // beats the best so far is searched for its index
+    const storage_type *codes = reinterpret_cast<const storage_type *>(x.data());
+    const size_t blocks = (x.size() + block - 1) / block;
+    std::vector<Best> partial((x.size() + chunk - 1) / chunk);
+    reduce_detail::for_runs(blocks, threads, [&]
+                            { return [&](size_t first, size_t last)
+                              {
+                                  const size_t end = std::min(x.size(), last * block);
+                                  Best best{INT64_MIN, first * block};
+                                  for (size_t begin = first * block; begin < end && best.key != INT64_MAX; begin += block)
+                                  {
+                                      const size_t block_end = std::min(end, begin + block);
+                                      int64_t largest = INT64_MIN;
+                                      for (size_t i = begin; i < block_end; ++i)
+                                      {
+                                          largest = std::max(largest, reduce_detail::order_key<T>(codes[i]));
+                                      }
+                                      if (largest > best.key)
+                                      {
+                                          size_t i = begin;
+                                          while (reduce_detail::order_key<T>(codes[i]) != largest)
+                                              ++i;
+                                          best = {largest, i};
+                                      }
+                                  }
+                                  partial[first / reduce_detail::run] = best;
+                              }; });
+    Best best = partial[0];
+    for (const Best &candidate : partial)
+    {
+        if (candidate.key > best.key)
+            best = candidate;
+    }
+    return best.index;
+}
+
+#endif // REDUCE_HPP_
@@ -0,0 +1,329 @@
+#ifndef TENSORFILE_HPP_
+#define TENSORFILE_HPP_
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "FloatingPoint_1.hpp"
+
+// On-disk arrays of FloatingPoint values and a read-only memory-mapped view of them.
+//
+// A file is a 64-byte TensorHeader followed by the encodings of the elements packed
+// back to back at 1 + exponent + mantissa bits each, element i starting at bit
+// i * width of the payload counted from the low bit of its first byte, so an E5M2
+// tensor takes one byte per element and a 1+5+2-bit one of n elements n bytes. The
+// payload is followed by 8 zero bytes so that any element can be read with one
+// unaligned 8-byte load plus at most one more byte. All fields are little-endian.
+//
+// MappedTensor maps the file and decodes an element only when it is read, so opening
+// a file costs the same whatever its size and pages are brought in by the first read
+// that touches them. Like std::ifstream, a failed open leaves the object closed:
+// check is_open().
+
+static_assert(std::endian::native == std::endian::little,
+              "tensor files are read and written in the host's byte order");
+
+struct TensorHeader
+{
+    char magic[8];           // "FPTENSOR"
+    uint32_t version;        // 1
+    uint8_t exponent;        // exponent bits
+    uint8_t mantissa;        // mantissa bits
+    int8_t bias_offset;      // FloatingPointTraits<bias_offset, specials, saturate>
+    uint8_t specials;        // Specials
+    uint8_t saturating;      // 0 or 1
+    uint8_t reserved[7];     // zero
+    uint64_t count;          // elements
+    uint64_t payload_offset; // bytes from the start of the file to the payload
+    uint8_t unused[24];      // zero
+};
+static_assert(sizeof(TensorHeader) == 64, "TensorHeader is 64 bytes on disk");
+
+namespace tensor_detail
+{
+    inline constexpr char magic[8] = {'F', 'P', 'T', 'E', 'N', 'S', 'O', 'R'};
+    inline constexpr uint32_t version = 1;
+    inline constexpr size_t padding = 8;
+
+    inline size_t payload_bytes(uint64_t count, int width)
+    {
+        return static_cast<size_t>((count * static_cast<uint64_t>(width) + 7) / 8);
+    }
+
+    template <class FP>
+    TensorHeader header_of(uint64_t count)
+    {
+        using Traits = typename FP::traits_type;
+        TensorHeader header{};
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = version;
+        header.exponent = static_cast<uint8_t>(FP::E_length);
+        header.mantissa = static_cast<uint8_t>(FP::M_length);
+        header.bias_offset = static_cast<int8_t>(Traits::bias_adjust);
+        header.specials = static_cast<uint8_t>(Traits::special_values);
+        header.saturating = Traits::saturating;
+        header.count = count;
+        header.payload_offset = sizeof(TensorHeader);
+        return header;
+    }
+
+    // Encoding of element index of a payload of width-bit elements
+    inline uint64_t read_bits(const uint8_t *payload, uint64_t index, int width)
+    {
+        const uint64_t bit = index * static_cast<uint64_t>(width);
+        const uint8_t *p = payload + bit / 8;
+        const int shift = static_cast<int>(bit % 8);
+        uint64_t word;
+        std::memcpy(&word, p, sizeof(word));
+        uint64_t value = word >> shift;
+        if (shift + width > 64)
+        {
+            value |= static_cast<uint64_t>(p[8]) << (64 - shift);
+        }
+        return width == 64 ? value : value & ((1ULL << width) - 1);
+    }
+
+    // Appends width-bit encodings to a byte buffer, low bits first
+    class BitWriter
+    {
+    public:
+        explicit BitWriter(int width) : width(width) {}
+
+        void put(uint64_t value)
+        {
+            word |= value << filled;
+            if (filled + width >= 64)
+            {
+                flush_word();
+                word = filled == 0 ? 0 : value >> (64 - filled);
+                filled = filled + width - 64;
+            }
+            else
+            {
+                filled += width;
+            }
+        }
+
+        // The bytes completed so far; a partial byte stays pending
+        std::vector<uint8_t> &bytes() { return out; }
+
+        // Move whole bytes of the pending word out, leaving fewer than 8 bits pending
+        void flush_bytes()
+        {
+            while (filled >= 8)
+            {
+                out.push_back(static_cast<uint8_t>(word));
+                word >>= 8;
+                filled -= 8;
+            }
+        }
+
+        // Emit the final partial byte, if any
+        void finish()
+        {
+            flush_bytes();
+            if (filled > 0)
+            {
+                out.push_back(static_cast<uint8_t>(word));
+                word = 0;
+                filled = 0;
+            }
+        }
+
+    private:
+        void flush_word()
+        {
+            uint8_t word_bytes[8];
+            std::memcpy(word_bytes, &word, sizeof(word));
+            out.insert(out.end(), word_bytes, word_bytes + 8);
+        }
+
+        int width;
+        uint64_t word = 0;
+        int filled = 0;
+        std::vector<uint8_t> out;
+    };
+}
+
+// Header of a tensor file, to find the format it holds before opening it; false when
+// the file cannot be read or is not a tensor file
+inline bool read_tensor_header(const char *path, TensorHeader &header)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    {
+        return false;
+    }
+    return std::memcmp(header.magic, tensor_detail::magic, sizeof(header.magic)) == 0 &&
+           header.version == tensor_detail::version;
+}
+
+// Write values to path as a tensor file; false on any I/O error
+template <int exponent, int mantissa, class Traits>
+bool write_tensor(const char *path, std::span<const FloatingPoint<exponent, mantissa, Traits>> values)
+{
+    using FP = FloatingPoint<exponent, mantissa, Traits>;
+    static_assert(std::is_standard_layout_v<FP> && sizeof(FP) == sizeof(typename FP::storage_type),
+                  "tensor files store FloatingPoint values as their packed encodings");
+    constexpr int width = 1 + exponent + mantissa;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    const TensorHeader header = tensor_detail::header_of<FP>(values.size());
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    // 8 elements fill whole bytes, so every block but the last is written byte-aligned
+    constexpr size_t block = 8 * 4096;
+    tensor_detail::BitWriter writer(width);
+    for (size_t first = 0; first < values.size(); first += block)
+    {
+        const size_t last = std::min(values.size(), first + block);
+        for (size_t i = first; i < last; ++i)
+        {
+            writer.put(values[i].to_bits());
+        }
+        if (last == values.size())
+        {
+            writer.finish();
+        }
+        writer.flush_bytes();
+        file.write(reinterpret_cast<const char *>(writer.bytes().data()), static_cast<std::streamsize>(writer.bytes().size()));
+        writer.bytes().clear();
+    }
+
+    const char zeros[tensor_detail::padding] = {};
+    file.write(zeros, sizeof(zeros));
+    file.close();
+    return !file.fail();
+}
+
+template <int exponent, int mantissa, class Traits = IEEETraits>
+class MappedTensor
+{
+public:
+    using value_type = FloatingPoint<exponent, mantissa, Traits>;
+
+    MappedTensor() = default;
+
+    // Map path read-only; stays closed if the file is missing, truncated, or holds
+    // another format
+    explicit MappedTensor(const char *path)
+    {
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            return;
+        }
+        struct stat info;
+        if (::fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) >= sizeof(TensorHeader))
+        {
+            const size_t file_bytes = static_cast<size_t>(info.st_size);
+            void *data = ::mmap(nullptr, file_bytes, PROT_READ, MAP_SHARED, fd, 0);
+            if (data != MAP_FAILED)
+            {
+                mapping = data;
+                mapped_bytes = file_bytes;
+                if (!attach())
+                {
+                    close();
+                }
+            }
+        }
+        ::close(fd);
+    }
+
+    MappedTensor(const MappedTensor &) = delete;
+    MappedTensor &operator=(const MappedTensor &) = delete;
+
+    MappedTensor(MappedTensor &&other) noexcept { swap(other); }
+    MappedTensor &operator=(MappedTensor &&other) noexcept
+    {
+        close();
+        swap(other);
+        return *this;
+    }
+
+    ~MappedTensor() { close(); }
+
+    bool is_open() const { return mapping != nullptr; }
+    size_t size() const { return count; }
+
+    value_type operator[](size_t i) const
+    {
+        return value_type(tensor_detail::read_bits(payload, i, width));
+    }
+
+    // out[k] = (*this)[first + k]
+    void read(size_t first, std::span<value_type> out) const
+    {
+        assert(first + out.size() <= count);
+        for (size_t k = 0; k < out.size(); ++k)
+        {
+            out[k] = value_type::from_bits(static_cast<typename value_type::storage_type>(tensor_detail::read_bits(payload, first + k, width)));
+        }
+    }
+
+    void close()
+    {
+        if (mapping != nullptr)
+        {
+            ::munmap(mapping, mapped_bytes);
+        }
+        mapping = nullptr;
+        mapped_bytes = 0;
+        payload = nullptr;
+        count = 0;
+    }
+
+private:
+    static constexpr int width = 1 + exponent + mantissa;
+
+    // Check the header against the format and the file size
+    bool attach()
+    {
+        TensorHeader header;
+        std::memcpy(&header, mapping, sizeof(header));
+        const TensorHeader expected = tensor_detail::header_of<value_type>(header.count);
+        if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 || header.version != expected.version ||
+            header.exponent != expected.exponent || header.mantissa != expected.mantissa ||
+            header.bias_offset != expected.bias_offset || header.specials != expected.specials ||
+            header.saturating != expected.saturating)
+        {
+            return false;
+        }
+        if (header.payload_offset < sizeof(TensorHeader) || header.payload_offset > mapped_bytes ||
+            header.count > (mapped_bytes - header.payload_offset) * 8 / width ||
+            mapped_bytes - header.payload_offset < tensor_detail::payload_bytes(header.count, width) + tensor_detail::padding)
+        {
+            return false;
+        }
+        payload = static_cast<const uint8_t *>(mapping) + header.payload_offset;
+        count = static_cast<size_t>(header.count);
+        return true;
+    }
+
+    void swap(MappedTensor &other) noexcept
+    {
+        std::swap(mapping, other.mapping);
+        std::swap(mapped_bytes, other.mapped_bytes);
+        std::swap(payload, other.payload);
+        std::swap(count, other.count);
+    }
+
+    void *mapping = nullptr;
+    size_t mapped_bytes = 0;
+    const uint8_t *payload = nullptr;
+    size_t count = 0;
+};
+
+#endif // TENSORFILE_HPP_